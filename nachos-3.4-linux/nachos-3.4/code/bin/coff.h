@@ -47,3 +47,54 @@ struct scnhdr {
         long            s_flags;        /* flags */
       };
  
+
+/* The symbol table ("symbolic header" and what it points to), located
+ * at f_symptr.  All the offsets are from the start of the file.  Only
+ * the external symbols are used by coff2noff, to tell the Nachos
+ * profiler where each procedure starts.
+ */
+
+typedef struct {
+        short   magic;          /* to verify validity of the table */
+        short   vstamp;         /* version stamp */
+        long    ilineMax;       /* number of line number entries */
+        long    cbLine;         /* number of bytes for line number entries */
+        long    cbLineOffset;   /* offset to start of line number entries */
+        long    idnMax;         /* max index into dense number table */
+        long    cbDnOffset;     /* offset to start dense number table */
+        long    ipdMax;         /* number of procedures */
+        long    cbPdOffset;     /* offset to procedure descriptor table */
+        long    isymMax;        /* number of local symbols */
+        long    cbSymOffset;    /* offset to start of local symbols */
+        long    ioptMax;        /* max index into optimization symbol entries */
+        long    cbOptOffset;    /* offset to optimization symbol entries */
+        long    iauxMax;        /* number of auxillary symbol entries */
+        long    cbAuxOffset;    /* offset to start of auxillary symbol entries*/
+        long    issMax;         /* max index into local strings */
+        long    cbSsOffset;     /* offset to start of local strings */
+        long    issExtMax;      /* max index into external strings */
+        long    cbSsExtOffset;  /* offset to start of external strings */
+        long    ifdMax;         /* number of file descriptor entries */
+        long    cbFdOffset;     /* offset to file descriptor table */
+        long    crfd;           /* number of relative file descriptor entries */
+        long    cbRfdOffset;    /* offset to relative file descriptor table */
+        long    iextMax;        /* max index into external symbols */
+        long    cbExtOffset;    /* offset to start of external symbol entries*/
+      } HDRR;
+
+#define magicSym        0x7009
+
+typedef struct {
+        unsigned short  flags;  /* jmptbl, cobol_main, weakext bits */
+        short   ifd;            /* where the iss and index fields point into */
+        long    iss;            /* index into external string space */
+        long    value;          /* value of symbol */
+        unsigned long   info;   /* st:6, sc:5, reserved:1, index:20 */
+      } EXTR;
+
+#define SymType(info)   ((info) & 0x3f)         /* the "st" field */
+#define SymClass(info)  (((info) >> 6) & 0x1f)  /* the "sc" field */
+
+#define stProc          6       /* procedure */
+#define stStaticProc    14      /* procedure local to its file */
+#define scText          1       /* text symbol */
@@ -15,6 +15,11 @@
  *	.data	-- initialized data
  *	.bss/.sbss -- uninitialized data (should be zero'd on program startup)
  *
+ * The NOFF format has no room for symbols, so if the COFF file has a
+ * symbol table, the start address and name of each procedure are
+ * written to a text file next to the NOFF file, "<noffFileName>.sym",
+ * one "<hex address> <name>" per line, for the Nachos profiler (-prof).
+ *
  * Copyright (c) 1992-1993 The Regents of the University of California.
  * All rights reserved.  See copyright.h for copyright notice and limitation 
  * of liability and disclaimer of warranty provisions.
@@ -93,6 +98,69 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/* Write the procedures found in the external symbols of the COFF file
+ * "fdIn" to "<noffName>.sym".  A missing or unreadable symbol table
+ * just means no symbols: the NOFF file is still good without them.
+ */
+void WriteSymbols(int fdIn, long symptr, char *noffName)
+{
+    HDRR symh;
+    EXTR ext;
+    char *symFileName, *strings;
+    FILE *symFile;
+    int i, count = 0;
+
+    if (symptr == 0)
+	return;				/* stripped */
+    lseek(fdIn, symptr, 0);
+    if (read(fdIn, (char *) &symh, sizeof(symh)) != sizeof(symh)
+		|| ShortToHost(symh.magic) != magicSym) {
+	fprintf(stderr, "Ignoring unrecognized symbol table\n");
+	return;
+    }
+    symh.issExtMax = WordToHost(symh.issExtMax);
+    symh.cbSsExtOffset = WordToHost(symh.cbSsExtOffset);
+    symh.iextMax = WordToHost(symh.iextMax);
+    symh.cbExtOffset = WordToHost(symh.cbExtOffset);
+
+    strings = (char *) malloc(symh.issExtMax + 1);
+    lseek(fdIn, symh.cbSsExtOffset, 0);
+    if (read(fdIn, strings, symh.issExtMax) != symh.issExtMax) {
+	fprintf(stderr, "Ignoring truncated symbol table\n");
+	free(strings);
+	return;
+    }
+    strings[symh.issExtMax] = '\0';
+
+    symFileName = (char *) malloc(strlen(noffName) + 5);
+    sprintf(symFileName, "%s.sym", noffName);
+    symFile = fopen(symFileName, "w");
+    if (symFile == NULL) {
+	perror(symFileName);
+	free(symFileName);
+	free(strings);
+	return;
+    }
+    lseek(fdIn, symh.cbExtOffset, 0);
+    for (i = 0; i < symh.iextMax; i++) {
+	if (read(fdIn, (char *) &ext, sizeof(ext)) != sizeof(ext))
+	    break;
+	ext.iss = WordToHost(ext.iss);
+	ext.value = WordToHost(ext.value);
+	ext.info = WordToHost(ext.info);
+	if ((SymType(ext.info) == stProc || SymType(ext.info) == stStaticProc)
+		&& SymClass(ext.info) == scText
+		&& ext.iss >= 0 && ext.iss < symh.issExtMax) {
+	    fprintf(symFile, "%08lx %s\n", ext.value, &strings[ext.iss]);
+	    count++;
+	}
+    }
+    printf("Wrote %d procedure symbols to %s\n", count, symFileName);
+    fclose(symFile);
+    free(symFileName);
+    free(strings);
+}
+
 void main (int argc, char **argv)
 {
     int fdIn, fdOut, numsections, i, inNoffFile;
@@ -126,6 +194,7 @@ void main (int argc, char **argv)
     ReadStruct(fdIn,fileh);
     fileh.f_magic = ShortToHost(fileh.f_magic);
     fileh.f_nscns = ShortToHost(fileh.f_nscns); 
+    fileh.f_symptr = WordToHost(fileh.f_symptr);
     if (fileh.f_magic != MIPSELMAGIC) {
 	fprintf(stderr, "File is not a MIPSEL COFF file\n");
         unlink(noffFileName);
@@ -225,6 +294,7 @@ void main (int argc, char **argv)
     }
     lseek(fdOut, 0, 0);
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
+    WriteSymbols(fdIn, fileh.f_symptr, noffFileName);
     close(fdIn);
     close(fdOut);
     exit(0);
@@ -178,6 +178,42 @@ Interrupt::OneTick()
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::QuietUserTicks
+// 	Return the number of calls to OneTick, while running user code,
+//	that are certain not to find any pending interrupt due -- they
+//	would only advance the clock.  The machine can execute that many
+//	instructions before it has to call OneTick again (see
+//	Machine::Tick), as long as nothing new is scheduled meanwhile.
+//
+//	If nothing is pending, we don't bother: OneTick is cheap then.
+//----------------------------------------------------------------------
+
+int
+Interrupt::QuietUserTicks()
+{
+    int when;
+
+    if (pending->SortedPeek(&when) == NULL || when <= stats->totalTicks)
+	return 0;
+    return (when - stats->totalTicks - 1) / UserTick;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SkipTicks
+// 	Advance simulated time by "n" user-mode ticks at once.  Exactly
+//	equivalent to "n" calls to OneTick, provided "n" is no more than
+//	QuietUserTicks() returned.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SkipTicks(int n)
+{
+    ASSERT(status == UserMode);
+    stats->totalTicks += n * UserTick;
+    stats->userTicks += n * UserTick;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -203,6 +239,8 @@ Interrupt::YieldOnReturn()
 //	Since something has to be running in order to put a thread
 //	on the ready queue, the only thing to do is to advance 
 //	simulated time until the next scheduled hardware interrupt.
+//	With user programs, the free pages are zeroed first, off the
+//	critical path of starting a program.
 //
 //	If there are no pending interrupts, stop.  There's nothing
 //	more for us to do.
@@ -212,6 +250,14 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+#ifdef USER_PROGRAM
+    // nothing to run: a good time to refill the pool of zeroed pages
+    if (mm != NULL) {
+	int zeroed = mm->ZeroFreePages();
+	if (zeroed > 0)
+	    DEBUG('i', "Zeroed %d free pages while idle.\n", zeroed);
+    }
+#endif
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
@@ -245,6 +291,73 @@ Interrupt::Halt()
     Cleanup();     // Never returns.
 }
 
+//----------------------------------------------------------------------
+// Interrupt::GetPending
+// 	Record the type of each pending interrupt, and how many ticks from
+//	now it is due, in due order.  The handlers themselves belong to
+//	this run of Nachos, so they can't be recorded; a checkpoint only
+//	keeps the timing (see RestorePending).
+//
+//	Returns the number of interrupts described, at most "max".
+//----------------------------------------------------------------------
+
+int
+Interrupt::GetPending(IntType *types, int *delays, int max)
+{
+    List *saved = new List();
+    PendingInterrupt *toOccur;
+    int when, n = 0;
+
+    while ((toOccur = (PendingInterrupt *) pending->SortedRemove(&when))
+	   != NULL) {
+	if (n < max) {
+	    types[n] = toOccur->type;
+	    delays[n] = when - stats->totalTicks;
+	    n++;
+	}
+	saved->SortedInsert(toOccur, when);
+    }
+    delete pending;
+    pending = saved;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RestorePending
+// 	The clock is about to be set to "now", the time a checkpoint was
+//	taken.  Re-time the interrupts the devices of this run have
+//	scheduled so far: the i'th pending interrupt of each type gets the
+//	delay the i'th one of that type had in the checkpoint; any others
+//	keep their delay from the current time.
+//----------------------------------------------------------------------
+
+void
+Interrupt::RestorePending(int now, IntType *types, int *delays, int n)
+{
+    List *retimed = new List();
+    PendingInterrupt *toOccur;
+    bool *used = new bool[n];
+    int when, i;
+
+    for (i = 0; i < n; i++)
+	used[i] = FALSE;
+    while ((toOccur = (PendingInterrupt *) pending->SortedRemove(&when))
+	   != NULL) {
+	for (i = 0; i < n; i++)
+	    if (!used[i] && types[i] == toOccur->type)
+		break;
+	if (i < n) {
+	    used[i] = TRUE;
+	    toOccur->when = now + delays[i];
+	} else
+	    toOccur->when = now + (when - stats->totalTicks);
+	retimed->SortedInsert(toOccur, toOccur->when);
+    }
+    delete pending;
+    pending = retimed;
+    delete [] used;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Schedule
 // 	Arrange for the CPU to be interrupted when simulated time
@@ -298,7 +411,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (DebugIsEnabled('i'))
 	DumpState();
     PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+		(PendingInterrupt *)pending->SortedPeek(&when);
 
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
@@ -306,10 +419,10 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
+    } else if (when > stats->totalTicks) {	// not time yet, leave it
+	return FALSE;				// where it is
     }
+    pending->SortedRemove(&when);
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
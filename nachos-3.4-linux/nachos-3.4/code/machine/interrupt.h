@@ -112,6 +112,18 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
 
+    int QuietUserTicks();		// How many user-mode OneTicks can
+					// go by before any interrupt is due?
+    void SkipTicks(int n);		// Account for "n" of those ticks
+					// in bulk, instead of calling OneTick
+
+    int GetPending(IntType *types, int *delays, int max);
+					// Describe what is pending, for a
+					// checkpoint
+    void RestorePending(int now, IntType *types, int *delays, int n);
+					// Re-time what is pending, when the
+					// clock is set back to a checkpoint
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
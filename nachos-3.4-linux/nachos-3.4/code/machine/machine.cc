@@ -18,6 +18,9 @@ static const char* exceptionNames[] = { "no exception", "syscall",
 				"bus error", "address error", "overflow",
 				"illegal instruction" };
 
+// Bytes of predecoded instructions kept for each physical page
+#define DecodedPageSize	(InstrsPerPage * sizeof(Instruction))
+
 //----------------------------------------------------------------------
 // CheckEndian
 // 	Check to be sure that the host really uses the format it says it 
@@ -50,27 +53,51 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"cpuCore" -- which interpreter core to execute user instructions with
+//	"batch" -- if TRUE, run user code up to the next pending interrupt
+//		without calling OneTick after each instruction
+//	"physPages" -- how many page frames of physical memory to simulate
+//
+//	Physical memory, and the predecoded copy of it, are mapped from the
+//	host lazily (see AllocLazyArray): they start out zero-filled, and
+//	only the parts user programs actually touch use host memory.  So
+//	even a large memory costs nothing at startup.  The predecoded copy
+//	is several times the size of memory, so it is sized in host words.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, CPUCore cpuCore, bool batch, int physPages)
 {
     int i;
 
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
-    mainMemory = new char[MemorySize];
-    for (i = 0; i < MemorySize; i++)
-      	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
+    numPhysPages = physPages;
+    memorySize = physPages * PageSize;
+    mainMemory = AllocLazyArray(memorySize);
+    ASSERT((size_t) numPhysPages <= (size_t) -1 / DecodedPageSize);
+    decodedInstrs = (Instruction *)
+		AllocLazyArray((size_t) numPhysPages * DecodedPageSize);
+    pageDecoded = new bool[numPhysPages];
+    decodeGeneration = new unsigned int[numPhysPages];
+    for (i = 0; i < numPhysPages; i++) {
+	pageDecoded[i] = FALSE;
+	decodeGeneration[i] = 0;
+    }
     tlb = NULL;
-    pageTable = NULL;
+    tlbASID = NULL;
+    tlbLastUse = NULL;
+    tlbSource = NULL;
+#ifdef USE_TLB
+    ConfigureTLB(TLBSize, TLBSize, TLBReplaceLRU);
 #endif
+    pageTable = NULL;
+    twoLevelTable = NULL;
+    FlushSoftTLB();
 
+    batchTicks = batch;
+    quietTicks = 0;
+    deferredTicks = 0;
+    core = cpuCore;
     singleStep = debug;
     CheckEndian();
 }
@@ -82,9 +109,17 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
-    if (tlb != NULL)
+    DeallocLazyArray(mainMemory, memorySize);
+    DeallocLazyArray((char *) decodedInstrs,
+		     (size_t) numPhysPages * DecodedPageSize);
+    delete [] pageDecoded;
+    delete [] decodeGeneration;
+    if (tlb != NULL) {
         delete [] tlb;
+        delete [] tlbASID;
+        delete [] tlbLastUse;
+        delete [] tlbSource;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -103,6 +138,9 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
     
 //  ASSERT(interrupt->getStatus() == UserMode);
+    FlushTicks();			// the kernel may look at the clock
+    if (profiler != NULL)
+	profiler->EndBlock();
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
     interrupt->setStatus(SystemMode);
@@ -110,6 +148,45 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     interrupt->setStatus(UserMode);
 }
 
+//----------------------------------------------------------------------
+// Machine::BatchedOneTick
+// 	Called by Tick when we've run out of instructions that we know
+//	can't reach a pending interrupt.  Bring the clock up to date, do
+//	a real OneTick (which may fire interrupt handlers and switch
+//	threads), and then, if batching, ask how long it will be until
+//	the next interrupt can be due.
+//
+//	With batching, Run executes instructions in a tight loop until
+//	that point and accounts for their ticks in bulk; stats and
+//	preemption points come out exactly as with one OneTick each.
+//----------------------------------------------------------------------
+
+void
+Machine::BatchedOneTick()
+{
+    FlushTicks();
+    interrupt->OneTick();
+    if (batchTicks && !singleStep && !DebugIsEnabled('i'))
+	quietTicks = interrupt->QuietUserTicks();
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTicks
+// 	Account for the ticks of the instructions run since the clock was
+//	last brought up to date, and stop deferring ticks until the next
+//	real OneTick.  Called before anything that may look at or change
+//	the clock or the pending interrupts: a trap into the kernel.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTicks()
+{
+    if (deferredTicks > 0)
+	interrupt->SkipTicks(deferredTicks);
+    deferredTicks = 0;
+    quietTicks = 0;
+}
+
 //----------------------------------------------------------------------
 // Machine::Debugger
 // 	Primitive debugger for user programs.  Note that we can't use
@@ -32,9 +32,16 @@
 					// the disk sector size, for
 					// simplicity
 
-#define NumPhysPages    32
-#define MemorySize 	(NumPhysPages * PageSize)
+#define DefaultPhysPages 32		// physical memory size, unless
+					// changed with -mem
 #define TLBSize		4		// if there is a TLB, make it small
+					// (the default; see -tlb)
+#define NumASIDs	64		// address space IDs the TLB can tag
+					// its entries with
+
+#define InstrsPerPage	(PageSize / 4)	// instruction words in one page
+#define SoftTLBSize	64		// entries in the software TLB; must
+					// be a power of two
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -91,6 +98,46 @@ enum ExceptionType { NoException,           // Everything ok!
 //    func - used along with op to select an arithmetic instruction
 //    address - word address or offset
 
+// How the TLB picks which entry of a set to replace when the kernel
+// loads a new translation, selected with the -tlbrepl flag.
+enum TLBPolicy { TLBReplaceLRU,		// least recently used entry
+		 TLBReplaceRandom	// any entry, at random
+};
+
+class Machine;
+class Instruction;
+
+// Each decoded instruction carries a pointer to the routine that executes
+// it (see the handlers in mipssim.cc), so the threaded interpreter core can
+// jump straight to it instead of going through the big opcode switch.
+// A handler returns FALSE if the instruction trapped to the kernel.
+
+typedef bool (*InstrHandler)(Machine *m, Instruction *instr);
+
+// The interpreter cores that Machine::Run can use to execute user code,
+// selected with the -cpu flag.  They produce identical results.
+enum CPUCore { SwitchCore,		// decode, then switch on the opcode
+	       ThreadedCore,		// call the predecoded handler
+	       BlockCore		// run whole translated basic blocks
+};
+
+// The simulator keeps a small direct-mapped cache of recent successful
+// translations, from virtual page to the host address of its frame in
+// mainMemory, separately for reads and writes.  This is not part of the
+// simulated hardware -- user programs and the kernel can't see it --
+// it just lets ReadMem/WriteMem skip Translate on the common path.
+//
+// "tag" is the page-aligned virtual address; an aligned reference
+// masks to exactly that value, while an unaligned one keeps some low
+// bits and so misses, taking the slow path that raises the exception.
+
+#define SoftTLBInvalid	0xffffffff	// tag that no reference can match
+
+class SoftTLBEntry {
+  public:
+    unsigned int tag;		// virtual address of the page
+    char *page;			// where the page is in mainMemory
+};
 
 class Instruction {
   public:
@@ -104,6 +151,11 @@ class Instruction {
 
     unsigned int extra;       // Immediate or target or shamt field or offset.
                      // Immediates are sign-extended.
+
+    InstrHandler handler;	// routine that executes this opCode
+    int blockLength;		// # of instructions in the translated
+				// basic block starting here; 0 if this
+				// instruction hasn't started a block yet
 };
 
 // The following class defines the simulated host workstation hardware, as 
@@ -121,7 +173,8 @@ class Instruction {
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, CPUCore cpuCore, bool batch, int physPages);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -136,8 +189,36 @@ class Machine {
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    void OneInstruction(); 	// Run one instruction of a user program.
+    void OneThreadedInstruction();
+				// Same, but dispatch through the predecoded
+				// instruction's handler
+    void RunBlock();		// Run the basic block starting at the PC,
+				// ticking the clock after each instruction
+    void Tick()			// Advance simulated time by one instruction
+	{ if (quietTicks > 0) { quietTicks--; deferredTicks++; }
+	  else BatchedOneTick(); }
+    void FlushTicks();		// Catch the clock up on deferred ticks,
+				// before the kernel looks at it
+    Instruction *FetchInstruction();
+				// Translate the PC and return the decoded
+				// instruction there, or NULL on an exception
+    Instruction *DecodedInstruction(int physAddr);
+    				// Return the predecoded instruction at
+				// "physAddr", decoding its page if needed
+    void InvalidateDecodedPage(int physPage)
+	{ pageDecoded[physPage] = FALSE; decodeGeneration[physPage]++; }
+				// Forget the predecoded instructions of a
+				// physical page whose contents changed
+    char *SoftTranslate(int virtAddr, int size, bool writing) {
+	SoftTLBEntry *e = &softTLB[writing]
+			[((unsigned)virtAddr / PageSize) & (SoftTLBSize - 1)];
+	return (e->tag == ((unsigned)virtAddr & (~(PageSize - 1) | (size - 1))))
+		? e->page + ((unsigned)virtAddr & (PageSize - 1)) : NULL; }
+				// Host address of a reference, if the
+				// software TLB has its page; else NULL
+    void FillSoftTLB(int virtAddr, int physAddr, bool writing);
+				// Remember a translation that succeeded
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -158,6 +239,27 @@ class Machine {
 				// Trap to the Nachos kernel, because of a
 				// system call or other exception.  
 
+    void ConfigureTLB(int size, int ways, TLBPolicy policy);
+				// Reshape the TLB: "size" entries in
+				// sets of "ways" each
+    void SetASID(int asid);	// Tag translations with "asid" from now on
+    void LoadTLB(TranslationEntry *entry);
+				// Copy "entry" into the TLB, for the
+				// current ASID, replacing some entry of
+				// its set
+    void FlushTLB(int asid);	// Invalidate the TLB entries of "asid"
+    void FlushTLBPage(int asid, unsigned int vpn);
+				// Invalidate the entry of "asid" for
+				// virtual page "vpn", if any
+    void SyncTLB();		// Write the use and dirty bits of the
+				// TLB back to the page tables
+
+    void FlushSoftTLB();	// Forget every cached translation.  The
+				// kernel must call this whenever it
+				// changes the page table or TLB in use
+				// (a PTE's mapping, valid, readOnly, use
+				// or dirty bits), not just on a switch.
+
     void Debugger();		// invoke the user program debugger
     void DumpState();		// print the user CPU and memory state 
 
@@ -170,6 +272,8 @@ class Machine {
 
     char *mainMemory;		// physical memory to store user program,
 				// code and data, while executing
+    int numPhysPages;		// # of page frames in mainMemory
+    int memorySize;		// # of bytes in mainMemory
     unsigned int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
 
@@ -177,10 +281,13 @@ class Machine {
 // to physical addresses (relative to the beginning of "mainMemory")
 // can be controlled by one of:
 //	a traditional linear page table
+//	a two-level page table, whose second-level tables only exist
+//	  where pages are mapped
 //  	a software-loaded translation lookaside buffer (tlb) -- a cache of 
 //	  mappings of virtual page #'s to physical page #'s
 //
-// If "tlb" is NULL, the linear page table is used
+// If "tlb" is NULL, the linear page table or the two-level page table
+// (whichever is set) is used
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
@@ -193,11 +300,52 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int tlbSize;			// # of entries in "tlb"
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
+    PageTable *twoLevelTable;
 
   private:
+    void DecodePage(int physPage);	// fill in the predecoded instructions
+					// for one physical page
+
+    Instruction *decodedInstrs;	// predecoded copy of every word in
+				// mainMemory, indexed by physAddr / 4
+    bool *pageDecoded;		// is "decodedInstrs" up to date for
+				// this physical page?
+    unsigned int *decodeGeneration;	// bumped each time a physical
+				// page's predecoded instructions are
+				// thrown away
+
+    int LookupTLB(unsigned int vpn);	// index of the TLB entry for
+					// "vpn" in the current ASID, or -1
+
+    int tlbWays;		// TLB associativity: entries per set
+    TLBPolicy tlbPolicy;	// which entry of a set LoadTLB replaces
+    int *tlbASID;		// ASID each TLB entry belongs to
+    unsigned int *tlbLastUse;	// when each entry was last used, for LRU
+    unsigned int tlbClock;	// counts TLB references, for LRU
+    TranslationEntry **tlbSource;	// page table entry each TLB entry
+					// was loaded from
+    void WriteBackTLB(int i);	// copy entry "i"'s use and dirty bits
+				// to its page table entry
+    int currentASID;		// ASID of the running address space
+
+    SoftTLBEntry softTLB[2][SoftTLBSize];
+				// the software TLB, indexed by
+				// [writing][vpn % SoftTLBSize]
+
+    void BatchedOneTick();	// Tick, when some interrupt may be due
+
+    bool batchTicks;		// run until the next pending interrupt,
+				// instead of calling OneTick each time?
+    int quietTicks;		// # of instructions we can still run
+				// before an interrupt can be due
+    int deferredTicks;		// # of instructions run since the clock
+				// was last brought up to date
+
+    CPUCore core;		// which interpreter Run uses
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
@@ -220,10 +368,72 @@ extern void ExceptionHandler(ExceptionType which);
 //	   user registers
 //	simulated machine byte ordering:
 //	   contents of main memory
-
-unsigned int WordToHost(unsigned int word);
-unsigned short ShortToHost(unsigned short shortword);
-unsigned int WordToMachine(unsigned int word);
-unsigned short ShortToMachine(unsigned short shortword);
+//
+// The byte order of the host is fixed when Nachos is compiled (see
+// HOST_IS_BIG_ENDIAN in Makefile.dep), so these are inline, and the
+// compiler drops them entirely on a little endian host.
+
+#ifdef HOST_IS_BIG_ENDIAN
+inline unsigned int
+WordToHost(unsigned int word)
+{
+    return ((word >> 24) & 0x000000ff) | ((word >> 8) & 0x0000ff00)
+	| ((word << 8) & 0x00ff0000) | ((word << 24) & 0xff000000);
+}
+
+inline unsigned short
+ShortToHost(unsigned short shortword)
+{
+    return (unsigned short) (((shortword << 8) & 0xff00)
+	| ((shortword >> 8) & 0x00ff));
+}
+#else
+inline unsigned int WordToHost(unsigned int word) { return word; }
+inline unsigned short ShortToHost(unsigned short shortword)
+					{ return shortword; }
+#endif // HOST_IS_BIG_ENDIAN
+
+inline unsigned int WordToMachine(unsigned int word)
+					{ return WordToHost(word); }
+inline unsigned short ShortToMachine(unsigned short shortword)
+					{ return ShortToHost(shortword); }
+
+// Typed access to simulated memory.  "hostAddr" points into mainMemory
+// (or any buffer holding data in the simulated machine's byte order);
+// the value is in host byte order.  The copy through memcpy is safe
+// even when "hostAddr" is not aligned for the host, and compiles to a
+// single load or store.
+
+inline unsigned int
+LoadWord(const char *hostAddr)
+{
+    unsigned int word;
+
+    memcpy(&word, hostAddr, sizeof(word));
+    return WordToHost(word);
+}
+
+inline unsigned short
+LoadShort(const char *hostAddr)
+{
+    unsigned short shortword;
+
+    memcpy(&shortword, hostAddr, sizeof(shortword));
+    return ShortToHost(shortword);
+}
+
+inline void
+StoreWord(char *hostAddr, unsigned int word)
+{
+    word = WordToMachine(word);
+    memcpy(hostAddr, &word, sizeof(word));
+}
+
+inline void
+StoreShort(char *hostAddr, unsigned short shortword)
+{
+    shortword = ShortToMachine(shortword);
+    memcpy(hostAddr, &shortword, sizeof(shortword));
+}
 
 #endif // MACHINE_H
@@ -17,6 +17,7 @@
 #include "system.h"
 
 static void Mult(int a, int b, bool signedArith, unsigned int *hiPtr, unsigned int *loPtr);
+static bool EndsBlock(int opCode);
 
 //----------------------------------------------------------------------
 // Machine::Run
@@ -29,16 +30,22 @@ static void Mult(int a, int b, bool signedArith, unsigned int *hiPtr, unsigned i
 
 void Machine::Run()
 {
-	Instruction *instr = new Instruction; // storage for decoded instruction
-
 	if (DebugIsEnabled('m'))
 		printf("Starting thread \"%s\" at time %d\n",
 					 currentThread->getName(), stats->totalTicks);
 	interrupt->setStatus(UserMode);
 	for (;;)
 	{
-		OneInstruction(instr);
-		interrupt->OneTick();
+		if (core == BlockCore && !singleStep)
+		{
+			RunBlock(); // ticks the clock itself
+			continue;
+		}
+		if (core == ThreadedCore || core == BlockCore)
+			OneThreadedInstruction();
+		else
+			OneInstruction();
+		Tick();
 		if (singleStep && (runUntilTime <= stats->totalTicks))
 			Debugger();
 	}
@@ -67,6 +74,49 @@ TypeToReg(RegType reg, Instruction *instr)
 	}
 }
 
+//----------------------------------------------------------------------
+// TraceInstruction
+// 	Print the instruction about to be executed, for the 'm' debug flag.
+//----------------------------------------------------------------------
+
+static void
+TraceInstruction(int pc, Instruction *instr)
+{
+	struct OpString *str = &opStrings[instr->opCode];
+
+	ASSERT(instr->opCode <= MaxOpcode);
+	printf("At PC = 0x%x: ", pc);
+	printf(str->string, TypeToReg(str->args[0], instr),
+				 TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
+	printf("\n");
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Translate the PC and return the decoded instruction stored there.
+//	If the translation fails, trap to the kernel and return NULL.
+//----------------------------------------------------------------------
+
+Instruction *Machine::FetchInstruction()
+{
+	int physAddr;
+	ExceptionType exception;
+	char *hostAddr;
+
+	if ((hostAddr = SoftTranslate(registers[PCReg], 4, FALSE)) != NULL)
+		return DecodedInstruction(hostAddr - mainMemory);
+
+	DEBUG('a', "Reading VA 0x%x, size 4\n", registers[PCReg]);
+	exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+	if (exception != NoException)
+	{
+		RaiseException(exception, registers[PCReg]);
+		return NULL;
+	}
+	FillSoftTLB(registers[PCReg], physAddr, FALSE);
+	return DecodedInstruction(physAddr);
+}
+
 //----------------------------------------------------------------------
 // Machine::OneInstruction
 // 	Execute one instruction from a user-level program
@@ -88,31 +138,27 @@ TypeToReg(RegType reg, Instruction *instr)
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	The one exception is the predecoded copy of each physical page
+//	(see DecodedInstruction), which is keyed by physical address and
+//	thrown away whenever the page is written, so it never goes stale.
 //----------------------------------------------------------------------
 
-void Machine::OneInstruction(Instruction *instr)
+void Machine::OneInstruction()
 {
-	int raw;
+	Instruction *instr;
 	int nextLoadReg = 0;
 	int nextLoadValue = 0; // record delayed load operation, to apply
 												 // in the future
 
 	// Fetch instruction
-	if (!machine->ReadMem(registers[PCReg], 4, &raw))
+	if ((instr = FetchInstruction()) == NULL)
 		return; // exception occurred
-	instr->value = raw;
-	instr->Decode();
 
 	if (DebugIsEnabled('m'))
-	{
-		struct OpString *str = &opStrings[instr->opCode];
-
-		ASSERT(instr->opCode <= MaxOpcode);
-		printf("At PC = 0x%x: ", registers[PCReg]);
-		printf(str->string, TypeToReg(str->args[0], instr),
-					 TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
-		printf("\n");
-	}
+		TraceInstruction(registers[PCReg], instr);
+	if (profiler != NULL)
+		profiler->CountInstruction(registers[PCReg], EndsBlock(instr->opCode));
 
 	// Compute next pc, but don't install in case there's an error or branch.
 	int pcAfter = registers[NextPCReg] + 4;
@@ -591,6 +637,956 @@ void Machine::DelayedLoad(int nextReg, int nextValue)
 	registers[0] = 0; // and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// Machine::OneThreadedInstruction
+// 	Execute one instruction from a user-level program, by calling the
+//	handler that was stored with the instruction when it was decoded.
+//
+//	This is the threaded-code alternative to the opcode switch in
+//	OneInstruction: there is one indirect call per instruction, and
+//	its target depends only on the instruction, which host branch
+//	predictors handle far better than one shared switch.  The
+//	handlers below must stay in step with the cases of that switch.
+//----------------------------------------------------------------------
+
+void Machine::OneThreadedInstruction()
+{
+	Instruction *instr;
+
+	if ((instr = FetchInstruction()) == NULL)
+		return; // exception occurred
+
+	if (DebugIsEnabled('m'))
+		TraceInstruction(registers[PCReg], instr);
+	if (profiler != NULL)
+		profiler->CountInstruction(registers[PCReg], EndsBlock(instr->opCode));
+
+	(*instr->handler)(this, instr);
+}
+
+//----------------------------------------------------------------------
+// EndsBlock
+// 	Return TRUE if a basic block must end after the instruction with
+//	operation "opCode": it may change the flow of control, or it
+//	always traps to the kernel.
+//----------------------------------------------------------------------
+
+static bool
+EndsBlock(int opCode)
+{
+	switch (opCode)
+	{
+	case OP_BEQ:
+	case OP_BGEZ:
+	case OP_BGEZAL:
+	case OP_BGTZ:
+	case OP_BLEZ:
+	case OP_BLTZ:
+	case OP_BLTZAL:
+	case OP_BNE:
+	case OP_J:
+	case OP_JAL:
+	case OP_JALR:
+	case OP_JR:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+//----------------------------------------------------------------------
+// TranslateBlock
+// 	Find the basic block that starts at the predecoded instruction
+//	"first", and record its length there.  The block runs up to and
+//	including the delay slot of the first branch or jump, up to a
+//	syscall or illegal instruction, or up to the end of the physical
+//	page, whichever comes first.  Blocks never cross a page boundary,
+//	since the next virtual page need not be the next physical one.
+//
+//	"offset" is the index of "first" within its page.
+//----------------------------------------------------------------------
+
+static int
+TranslateBlock(Instruction *first, int offset)
+{
+	int length = 0;
+
+	while (offset + length < InstrsPerPage)
+	{
+		Instruction *instr = &first[length++];
+
+		if (instr->opCode == OP_SYSCALL || instr->opCode == OP_RES ||
+				instr->opCode == OP_UNIMP)
+			break;
+		if (EndsBlock(instr->opCode))
+		{
+			if (offset + length < InstrsPerPage)
+				length++; // the delay slot
+			break;
+		}
+	}
+	first->blockLength = length;
+	return length;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute the basic block of user code starting at the PC, without
+//	going back through Run or re-translating the PC in between.
+//	A block is translated once, the first time it is run, into its
+//	length; the predecoded handlers of its instructions are the chain
+//	of routines that run it.  The translation lives in the predecoded
+//	page, so it is thrown away along with it.
+//
+//	To stay exactly in step with the other cores, we still tick the
+//	clock after every instruction, and we leave the block early when:
+//	    an instruction traps to the kernel (the exception handler
+//	      may have changed the PC, the registers, or memory);
+//	    the PC isn't where the block expects it (an interrupt handler
+//	      switched threads and the kernel moved us somewhere else);
+//	    the block's page was written or reloaded (the instructions we
+//	      are about to run may have changed).
+//	A tick can switch threads, and the others can throw the page away
+//	and decode it again before we get back, so "pageDecoded" alone
+//	could be TRUE over a different page: we compare the page's decode
+//	generation with the one the block started out with instead.
+//	Branch delay slots and delayed loads need no special care: they
+//	are carried in the registers exactly as OneInstruction does.
+//----------------------------------------------------------------------
+
+void Machine::RunBlock()
+{
+	Instruction *instr;
+	int physPage, length, pc;
+	unsigned int generation;
+
+	if ((instr = FetchInstruction()) == NULL)
+	{
+		Tick(); // exception occurred
+		return;
+	}
+	physPage = (instr - decodedInstrs) / InstrsPerPage;
+	generation = decodeGeneration[physPage];
+	length = instr->blockLength;
+	if (length == 0)
+		length = TranslateBlock(instr, (instr - decodedInstrs) % InstrsPerPage);
+
+	for (pc = registers[PCReg];; pc += 4, instr++)
+	{
+		if (DebugIsEnabled('m'))
+			TraceInstruction(pc, instr);
+		if (profiler != NULL)
+			profiler->CountInstruction(pc, EndsBlock(instr->opCode));
+		bool retired = (*instr->handler)(this, instr);
+		Tick();
+		if (!retired || --length == 0 ||
+				decodeGeneration[physPage] != generation ||
+				registers[PCReg] != (unsigned int)pc + 4)
+			return;
+	}
+}
+
+//----------------------------------------------------------------------
+// Retire
+// 	Finish an instruction that executed without trapping: do any
+//	delayed load and advance the program counters, exactly as the end
+//	of OneInstruction does.
+//
+//	"pcAfter" -- where to go after the instruction in the delay slot
+//	"nextLoadReg", "nextLoadValue" -- the load this instruction started
+//----------------------------------------------------------------------
+
+static inline bool
+Retire(Machine *m, int pcAfter, int nextLoadReg, int nextLoadValue)
+{
+	m->DelayedLoad(nextLoadReg, nextLoadValue);
+	m->registers[PrevPCReg] = m->registers[PCReg];
+	m->registers[PCReg] = m->registers[NextPCReg];
+	m->registers[NextPCReg] = pcAfter;
+	return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Instruction handlers
+// 	One routine per opcode, for the threaded interpreter core.  Each
+//	executes the instruction "instr" on machine "m" and returns TRUE,
+//	or raises an exception and returns FALSE.  The bodies are the
+//	cases of the switch in OneInstruction, kept statement for
+//	statement so both cores compute the same results.
+//----------------------------------------------------------------------
+
+static bool
+ExecADD(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int sum = registers[instr->rs] + registers[instr->rt];
+
+	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+			((registers[instr->rs] ^ sum) & SIGN_BIT))
+	{
+		m->RaiseException(OverflowException, 0);
+		return FALSE;
+	}
+	registers[instr->rd] = sum;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecADDI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int sum = registers[instr->rs] + instr->extra;
+
+	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+			((instr->extra ^ sum) & SIGN_BIT))
+	{
+		m->RaiseException(OverflowException, 0);
+		return FALSE;
+	}
+	registers[instr->rt] = sum;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecADDIU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rt] = registers[instr->rs] + instr->extra;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecADDU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecAND(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecANDI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecBEQ(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int pcAfter = registers[NextPCReg] + 4;
+
+	if (registers[instr->rs] == registers[instr->rt])
+		pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecBGEZ(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int pcAfter = registers[NextPCReg] + 4;
+
+	if (!(registers[instr->rs] & SIGN_BIT))
+		pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecBGEZAL(Machine *m, Instruction *instr)
+{
+	m->registers[R31] = m->registers[NextPCReg] + 4;
+	return ExecBGEZ(m, instr);
+}
+
+static bool
+ExecBGTZ(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int pcAfter = registers[NextPCReg] + 4;
+
+	if (registers[instr->rs] > 0)
+		pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecBLEZ(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int pcAfter = registers[NextPCReg] + 4;
+
+	if (registers[instr->rs] <= 0)
+		pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecBLTZ(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int pcAfter = registers[NextPCReg] + 4;
+
+	if (registers[instr->rs] & SIGN_BIT)
+		pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecBLTZAL(Machine *m, Instruction *instr)
+{
+	m->registers[R31] = m->registers[NextPCReg] + 4;
+	return ExecBLTZ(m, instr);
+}
+
+static bool
+ExecBNE(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int pcAfter = registers[NextPCReg] + 4;
+
+	if (registers[instr->rs] != registers[instr->rt])
+		pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecDIV(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	if (registers[instr->rt] == 0)
+	{
+		registers[LoReg] = 0;
+		registers[HiReg] = 0;
+	}
+	else
+	{
+		registers[LoReg] = registers[instr->rs] / registers[instr->rt];
+		registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+	}
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecDIVU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	unsigned int rs = (unsigned int)registers[instr->rs];
+	unsigned int rt = (unsigned int)registers[instr->rt];
+	int tmp;
+
+	if (rt == 0)
+	{
+		registers[LoReg] = 0;
+		registers[HiReg] = 0;
+	}
+	else
+	{
+		tmp = rs / rt;
+		registers[LoReg] = (int)tmp;
+		tmp = rs % rt;
+		registers[HiReg] = (int)tmp;
+	}
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecJ(Machine *m, Instruction *instr)
+{
+	int pcAfter = m->registers[NextPCReg] + 4;
+
+	pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+	return Retire(m, pcAfter, 0, 0);
+}
+
+static bool
+ExecJAL(Machine *m, Instruction *instr)
+{
+	m->registers[R31] = m->registers[NextPCReg] + 4;
+	return ExecJ(m, instr);
+}
+
+static bool
+ExecJR(Machine *m, Instruction *instr)
+{
+	return Retire(m, m->registers[instr->rs], 0, 0);
+}
+
+static bool
+ExecJALR(Machine *m, Instruction *instr)
+{
+	m->registers[instr->rd] = m->registers[NextPCReg] + 4;
+	return ExecJR(m, instr);
+}
+
+static bool
+ExecLB(Machine *m, Instruction *instr)	// LB and LBU
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
+
+	if (!m->ReadMem(tmp, 1, &value))
+		return FALSE;
+
+	if ((value & 0x80) && (instr->opCode == OP_LB))
+		value |= 0xffffff00;
+	else
+		value &= 0xff;
+	return Retire(m, registers[NextPCReg] + 4, instr->rt, value);
+}
+
+static bool
+ExecLH(Machine *m, Instruction *instr)	// LH and LHU
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
+
+	if (tmp & 0x1)
+	{
+		m->RaiseException(AddressErrorException, tmp);
+		return FALSE;
+	}
+	if (!m->ReadMem(tmp, 2, &value))
+		return FALSE;
+
+	if ((value & 0x8000) && (instr->opCode == OP_LH))
+		value |= 0xffff0000;
+	else
+		value &= 0xffff;
+	return Retire(m, registers[NextPCReg] + 4, instr->rt, value);
+}
+
+static bool
+ExecLUI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+	registers[instr->rt] = instr->extra << 16;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecLW(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
+
+	if (tmp & 0x3)
+	{
+		m->RaiseException(AddressErrorException, tmp);
+		return FALSE;
+	}
+	if (!m->ReadMem(tmp, 4, &value))
+		return FALSE;
+	return Retire(m, registers[NextPCReg] + 4, instr->rt, value);
+}
+
+static bool
+ExecLWL(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value, nextLoadValue;
+
+	// ReadMem assumes all 4 byte requests are aligned on an even
+	// word boundary (see OneInstruction).
+	ASSERT((tmp & 0x3) == 0);
+
+	if (!m->ReadMem(tmp, 4, &value))
+		return FALSE;
+	if (registers[LoadReg] == instr->rt)
+		nextLoadValue = registers[LoadValueReg];
+	else
+		nextLoadValue = registers[instr->rt];
+	switch (tmp & 0x3)
+	{
+	case 0:
+		nextLoadValue = value;
+		break;
+	case 1:
+		nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
+		break;
+	case 2:
+		nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
+		break;
+	case 3:
+		nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
+		break;
+	}
+	return Retire(m, registers[NextPCReg] + 4, instr->rt, nextLoadValue);
+}
+
+static bool
+ExecLWR(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value, nextLoadValue;
+
+	// ReadMem assumes all 4 byte requests are aligned on an even
+	// word boundary (see OneInstruction).
+	ASSERT((tmp & 0x3) == 0);
+
+	if (!m->ReadMem(tmp, 4, &value))
+		return FALSE;
+	if (registers[LoadReg] == instr->rt)
+		nextLoadValue = registers[LoadValueReg];
+	else
+		nextLoadValue = registers[instr->rt];
+	switch (tmp & 0x3)
+	{
+	case 0:
+		nextLoadValue = (nextLoadValue & 0xffffff00) |
+										((value >> 24) & 0xff);
+		break;
+	case 1:
+		nextLoadValue = (nextLoadValue & 0xffff0000) |
+										((value >> 16) & 0xffff);
+		break;
+	case 2:
+		nextLoadValue = (nextLoadValue & 0xff000000) | ((value >> 8) & 0xffffff);
+		break;
+	case 3:
+		nextLoadValue = value;
+		break;
+	}
+	return Retire(m, registers[NextPCReg] + 4, instr->rt, nextLoadValue);
+}
+
+static bool
+ExecMFHI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[HiReg];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecMFLO(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[LoReg];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecMTHI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[HiReg] = registers[instr->rs];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecMTLO(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[LoReg] = registers[instr->rs];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecMULT(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	Mult(registers[instr->rs], registers[instr->rt], TRUE,
+			 &registers[HiReg], &registers[LoReg]);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecMULTU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	Mult(registers[instr->rs], registers[instr->rt], FALSE,
+			 &registers[HiReg], &registers[LoReg]);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecNOR(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecOR(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecORI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSB(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	if (!m->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
+		return FALSE;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSH(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	if (!m->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
+		return FALSE;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSLL(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rt] << instr->extra;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSLLV(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rt] << (registers[instr->rs] & 0x1f);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSLT(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	if (registers[instr->rs] < registers[instr->rt])
+		registers[instr->rd] = 1;
+	else
+		registers[instr->rd] = 0;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSLTI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	if (registers[instr->rs] < instr->extra)
+		registers[instr->rt] = 1;
+	else
+		registers[instr->rt] = 0;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSLTIU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	unsigned int rs = registers[instr->rs];
+	unsigned int imm = instr->extra;
+
+	if (rs < imm)
+		registers[instr->rt] = 1;
+	else
+		registers[instr->rt] = 0;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSLTU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	unsigned int rs = registers[instr->rs];
+	unsigned int rt = registers[instr->rt];
+
+	if (rs < rt)
+		registers[instr->rd] = 1;
+	else
+		registers[instr->rd] = 0;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSRA(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rt] >> instr->extra;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSRAV(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rt] >>
+												 (registers[instr->rs] & 0x1f);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSRL(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rt];
+
+	tmp >>= instr->extra;
+	registers[instr->rd] = tmp;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSRLV(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rt];
+
+	tmp >>= (registers[instr->rs] & 0x1f);
+	registers[instr->rd] = tmp;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSUB(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int diff = registers[instr->rs] - registers[instr->rt];
+
+	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+			((registers[instr->rs] ^ diff) & SIGN_BIT))
+	{
+		m->RaiseException(OverflowException, 0);
+		return FALSE;
+	}
+	registers[instr->rd] = diff;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSUBU(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSW(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	if (!m->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
+		return FALSE;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSWL(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
+
+	// The little endian/big endian swap code would
+	// fail (I think) if the other cases are ever exercised.
+	ASSERT((tmp & 0x3) == 0);
+
+	if (!m->ReadMem((tmp & ~0x3), 4, &value))
+		return FALSE;
+	switch (tmp & 0x3)
+	{
+	case 0:
+		value = registers[instr->rt];
+		break;
+	case 1:
+		value = (value & 0xff000000) | ((registers[instr->rt] >> 8) &
+																		0xffffff);
+		break;
+	case 2:
+		value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) &
+																		0xffff);
+		break;
+	case 3:
+		value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) &
+																		0xff);
+		break;
+	}
+	if (!m->WriteMem((tmp & ~0x3), 4, value))
+		return FALSE;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSWR(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+	int tmp = registers[instr->rs] + instr->extra;
+	int value;
+
+	// The little endian/big endian swap code would
+	// fail (I think) if the other cases are ever exercised.
+	ASSERT((tmp & 0x3) == 0);
+
+	if (!m->ReadMem((tmp & ~0x3), 4, &value))
+		return FALSE;
+	switch (tmp & 0x3)
+	{
+	case 0:
+		value = (value & 0xffffff) | (registers[instr->rt] << 24);
+		break;
+	case 1:
+		value = (value & 0xffff) | (registers[instr->rt] << 16);
+		break;
+	case 2:
+		value = (value & 0xff) | (registers[instr->rt] << 8);
+		break;
+	case 3:
+		value = registers[instr->rt];
+		break;
+	}
+	if (!m->WriteMem((tmp & ~0x3), 4, value))
+		return FALSE;
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecSYSCALL(Machine *m, Instruction *instr)
+{
+	m->RaiseException(SyscallException, 0);
+	return FALSE;
+}
+
+static bool
+ExecXOR(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecXORI(Machine *m, Instruction *instr)
+{
+	unsigned int *registers = m->registers;
+
+	registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
+	return Retire(m, registers[NextPCReg] + 4, 0, 0);
+}
+
+static bool
+ExecIllegal(Machine *m, Instruction *instr)	// OP_RES and OP_UNIMP
+{
+	m->RaiseException(IllegalInstrException, 0);
+	return FALSE;
+}
+
+static bool
+ExecBad(Machine *m, Instruction *instr)	// opcodes Decode never produces
+{
+	ASSERT(FALSE);
+	return FALSE;
+}
+
+// The handler for each opCode, indexed by the OP_ values in mipssim.h
+
+static InstrHandler opHandlers[MaxOpcode + 1] = {
+	ExecBad,	ExecADD,	ExecADDI,	ExecADDIU,	// 0-3
+	ExecADDU,	ExecAND,	ExecANDI,	ExecBEQ,	// 4-7
+	ExecBGEZ,	ExecBGEZAL,	ExecBGTZ,	ExecBLEZ,	// 8-11
+	ExecBLTZ,	ExecBLTZAL,	ExecBNE,	ExecBad,	// 12-15
+	ExecDIV,	ExecDIVU,	ExecJ,		ExecJAL,	// 16-19
+	ExecJALR,	ExecJR,		ExecLB,		ExecLB,		// 20-23
+	ExecLH,		ExecLH,		ExecLUI,	ExecLW,		// 24-27
+	ExecLWL,	ExecLWR,	ExecBad,	ExecMFHI,	// 28-31
+	ExecMFLO,	ExecBad,	ExecMTHI,	ExecMTLO,	// 32-35
+	ExecMULT,	ExecMULTU,	ExecNOR,	ExecOR,		// 36-39
+	ExecORI,	ExecBad,	ExecSB,		ExecSH,		// 40-43
+	ExecSLL,	ExecSLLV,	ExecSLT,	ExecSLTI,	// 44-47
+	ExecSLTIU,	ExecSLTU,	ExecSRA,	ExecSRAV,	// 48-51
+	ExecSRL,	ExecSRLV,	ExecSUB,	ExecSUBU,	// 52-55
+	ExecSW,		ExecSWL,	ExecSWR,	ExecXOR,	// 56-59
+	ExecXORI,	ExecSYSCALL,	ExecIllegal,	ExecIllegal	// 60-63
+};
+
+//----------------------------------------------------------------------
+// Machine::DecodedInstruction
+// 	Return the decoded form of the instruction stored at physical
+//	address "physAddr".  The first fetch from a physical page decodes
+//	the whole page; later fetches are just an array lookup, until
+//	the page is written (WriteMem) or reloaded by the kernel
+//	(InvalidateDecodedPage).
+//----------------------------------------------------------------------
+
+Instruction *Machine::DecodedInstruction(int physAddr)
+{
+	int physPage = physAddr / PageSize;
+
+	if (!pageDecoded[physPage])
+		DecodePage(physPage);
+	return &decodedInstrs[physAddr / 4];
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodePage
+// 	Decode every word of physical page "physPage" as an instruction.
+//	Data words decode to garbage, but they are never executed.
+//----------------------------------------------------------------------
+
+void Machine::DecodePage(int physPage)
+{
+	Instruction *instr = &decodedInstrs[physPage * InstrsPerPage];
+	char *word = &mainMemory[physPage * PageSize];
+
+	for (int i = 0; i < InstrsPerPage; i++, instr++, word += 4)
+	{
+		instr->value = LoadWord(word);
+		instr->Decode();
+		instr->blockLength = 0;
+	}
+	pageDecoded[physPage] = TRUE;
+}
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction
@@ -650,6 +1646,7 @@ void Instruction::Decode()
 			opCode = OP_UNIMP;
 		}
 	}
+	handler = opHandlers[opCode];
 }
 
 //----------------------------------------------------------------------
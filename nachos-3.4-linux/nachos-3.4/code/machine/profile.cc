@@ -0,0 +1,401 @@
+// profile.cc
+//	Routines to count where user programs spend their time, and to
+//	report it at shutdown.  See profile.h.
+//
+//	The counts are plain arrays indexed by word address or virtual
+//	page number, grown on demand; user address spaces are small, so
+//	this is both the fastest and the simplest thing to do.
+
+#include <stdlib.h>		// for qsort; before sysdep.h, which
+				// declares some of it differently
+#include "copyright.h"
+#include "profile.h"
+#include "machine.h"
+
+#define ReportTopPCs	50	// how many of the hottest instructions,
+#define ReportTopBlocks	50	// and basic blocks, to list
+
+//----------------------------------------------------------------------
+// Grow
+// 	Make sure "*counts" (of "*size" entries) has an entry "index",
+//	enlarging it and zeroing the new entries if not.
+//----------------------------------------------------------------------
+
+static void
+Grow(unsigned int **counts, int *size, int index)
+{
+    int newSize;
+    unsigned int *newCounts;
+
+    if (index < *size)
+	return;
+    newSize = (*size == 0) ? 256 : *size;
+    while (newSize <= index)
+	newSize *= 2;
+    newCounts = new unsigned int[newSize];
+    for (int i = 0; i < newSize; i++)
+	newCounts[i] = (i < *size) ? (*counts)[i] : 0;
+    delete [] *counts;
+    *counts = newCounts;
+    *size = newSize;
+}
+
+//----------------------------------------------------------------------
+// ProfileImage::ProfileImage
+// 	Start an empty profile for the executable "fileName", and read
+//	its procedure symbols from "fileName.sym", if coff2noff wrote one.
+//	The symbols are kept sorted by address.
+//----------------------------------------------------------------------
+
+ProfileImage::ProfileImage(char *fileName)
+{
+    char *symName = new char[strlen(fileName) + 5];
+    char buf[256];
+    unsigned int addr;
+    FILE *symFile;
+    int max = 64;
+
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    next = NULL;
+    instrCounts = blockCounts = NULL;
+    numInstrs = 0;
+    loadCounts = storeCounts = NULL;
+    numPages = 0;
+
+    symbols = new ProfileSymbol[max];
+    numSymbols = 0;
+    sprintf(symName, "%s.sym", fileName);
+    if ((symFile = fopen(symName, "r")) == NULL)
+	DEBUG('p', "No symbols for %s\n", fileName);
+    else {
+	while (fscanf(symFile, "%x %255s", &addr, buf) == 2) {
+	    if (numSymbols == max) {		// make room
+		ProfileSymbol *more = new ProfileSymbol[max * 2];
+		for (int i = 0; i < numSymbols; i++)
+		    more[i] = symbols[i];
+		delete [] symbols;
+		symbols = more;
+		max *= 2;
+	    }
+	    int i = numSymbols++;		// insert in order
+	    for (; i > 0 && symbols[i - 1].addr > addr; i--)
+		symbols[i] = symbols[i - 1];
+	    symbols[i].addr = addr;
+	    symbols[i].name = new char[strlen(buf) + 1];
+	    strcpy(symbols[i].name, buf);
+	}
+	fclose(symFile);
+	DEBUG('p', "Read %d symbols for %s\n", numSymbols, fileName);
+    }
+    delete [] symName;
+}
+
+//----------------------------------------------------------------------
+// ProfileImage::~ProfileImage
+//----------------------------------------------------------------------
+
+ProfileImage::~ProfileImage()
+{
+    for (int i = 0; i < numSymbols; i++)
+	delete [] symbols[i].name;
+    delete [] symbols;
+    delete [] instrCounts;
+    delete [] blockCounts;
+    delete [] loadCounts;
+    delete [] storeCounts;
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// ProfileImage::FindSymbol
+// 	Return the index of the procedure that "pc" is in -- the last one
+//	that starts at or below it -- or -1 if "pc" is below them all.
+//----------------------------------------------------------------------
+
+int
+ProfileImage::FindSymbol(unsigned int pc)
+{
+    int low = 0, high = numSymbols - 1, found = -1;
+
+    while (low <= high) {
+	int mid = (low + high) / 2;
+	if (symbols[mid].addr <= pc) {
+	    found = mid;
+	    low = mid + 1;
+	} else
+	    high = mid - 1;
+    }
+    return found;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Initialize the profiler.
+//
+//	"fileName" -- where to write the report; the folded stacks go
+//		to "fileName.folded"
+//----------------------------------------------------------------------
+
+Profiler::Profiler(char *fileName)
+{
+    reportName = new char[strlen(fileName) + 1];
+    strcpy(reportName, fileName);
+    images = current = NULL;
+    nextPC = delaySlotPC = -1;
+    newBlock = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Profiler::~Profiler
+//----------------------------------------------------------------------
+
+Profiler::~Profiler()
+{
+    while (images != NULL) {
+	ProfileImage *image = images;
+	images = image->next;
+	delete image;
+    }
+    delete [] reportName;
+}
+
+//----------------------------------------------------------------------
+// Profiler::FindImage
+// 	Return the profile of the executable "fileName", starting a new
+//	one the first time the executable is loaded.
+//----------------------------------------------------------------------
+
+ProfileImage *
+Profiler::FindImage(char *fileName)
+{
+    ProfileImage *image;
+
+    for (image = images; image != NULL; image = image->next)
+	if (!strcmp(image->name, fileName))
+	    return image;
+    image = new ProfileImage(fileName);
+    image->next = images;
+    images = image;
+    return image;
+}
+
+//----------------------------------------------------------------------
+// Profiler::SetImage
+// 	The kernel is switching to an address space running "image"
+//	(NULL if we don't know which executable it is).  Whatever it
+//	executes next starts a new basic block.
+//----------------------------------------------------------------------
+
+void
+Profiler::SetImage(ProfileImage *image)
+{
+    current = image;
+    newBlock = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Profiler::CountInstruction
+// 	Count one execution of the instruction at "pc".
+//
+//	The instruction starts a basic block if control didn't just fall
+//	through to it: the previous instruction wasn't at pc - 4 (a taken
+//	branch, or we are back from another thread), the previous one was
+//	a delay slot (so a branch was just resolved, taken or not), or the
+//	previous one trapped to the kernel (EndBlock).
+//
+//	"branch" -- TRUE if this instruction is a branch or jump
+//----------------------------------------------------------------------
+
+void
+Profiler::CountInstruction(int pc, bool branch)
+{
+    unsigned int index = (unsigned)pc / 4;
+
+    if (current == NULL)
+	return;
+    if (index >= (unsigned)current->numInstrs) {
+	int size = current->numInstrs;
+	Grow(&current->instrCounts, &current->numInstrs, index);
+	Grow(&current->blockCounts, &size, index);
+    }
+    if (newBlock || pc != nextPC)
+	current->blockCounts[index]++;
+    current->instrCounts[index]++;
+
+    newBlock = (pc == delaySlotPC);
+    if (branch)
+	delaySlotPC = pc + 4;
+    nextPC = pc + 4;
+}
+
+//----------------------------------------------------------------------
+// Profiler::CountLoad, Profiler::CountStore
+// 	Count one load from, or store to, user virtual address "addr".
+//----------------------------------------------------------------------
+
+void
+Profiler::CountLoad(int addr)
+{
+    unsigned int vpn = (unsigned)addr / PageSize;
+
+    if (current == NULL)
+	return;
+    if (vpn >= (unsigned)current->numPages) {
+	int size = current->numPages;
+	Grow(&current->loadCounts, &current->numPages, vpn);
+	Grow(&current->storeCounts, &size, vpn);
+    }
+    current->loadCounts[vpn]++;
+}
+
+void
+Profiler::CountStore(int addr)
+{
+    unsigned int vpn = (unsigned)addr / PageSize;
+
+    if (current == NULL)
+	return;
+    if (vpn >= (unsigned)current->numPages) {
+	int size = current->numPages;
+	Grow(&current->loadCounts, &current->numPages, vpn);
+	Grow(&current->storeCounts, &size, vpn);
+    }
+    current->storeCounts[vpn]++;
+}
+
+//----------------------------------------------------------------------
+// SortByCount
+// 	Return the indices of the non-zero entries of "counts" (of "size"
+//	entries), hottest first, storing how many there are in "*num".
+//----------------------------------------------------------------------
+
+static unsigned int *sortCounts;	// what CompareCounts looks at
+
+static int
+CompareCounts(const void *a, const void *b)
+{
+    unsigned int ca = sortCounts[*(const int *)a];
+    unsigned int cb = sortCounts[*(const int *)b];
+
+    if (ca != cb)
+	return (ca > cb) ? -1 : 1;
+    return *(const int *)a - *(const int *)b;	// then by address
+}
+
+static int *
+SortByCount(unsigned int *counts, int size, int *num)
+{
+    int *order = new int[size > 0 ? size : 1];
+
+    *num = 0;
+    for (int i = 0; i < size; i++)
+	if (counts[i] != 0)
+	    order[(*num)++] = i;
+    sortCounts = counts;
+    qsort(order, *num, sizeof(int), CompareCounts);
+    return order;
+}
+
+//----------------------------------------------------------------------
+// Profiler::ReportImage
+// 	Write the profile of one executable to the report "out", and its
+//	per-procedure totals to the folded stacks file "folded".
+//----------------------------------------------------------------------
+
+void
+Profiler::ReportImage(FILE *out, FILE *folded, ProfileImage *image)
+{
+    unsigned int total = 0, *procCounts;
+    int *order, num, i, sym;
+    const char *program = strrchr(image->name, '/');
+
+    program = (program == NULL) ? image->name : program + 1;
+    for (i = 0; i < image->numInstrs; i++)
+	total += image->instrCounts[i];
+    fprintf(out, "==== %s: %u instructions, %d symbols ====\n\n",
+	    image->name, total, image->numSymbols);
+    if (total == 0)
+	total = 1;			// don't divide by zero below
+
+    // procedures: add up their instructions
+    procCounts = new unsigned int[image->numSymbols + 1];
+    for (i = 0; i <= image->numSymbols; i++)
+	procCounts[i] = 0;
+    for (i = 0; i < image->numInstrs; i++)
+	if (image->instrCounts[i] != 0) {
+	    sym = image->FindSymbol(i * 4);
+	    procCounts[(sym == -1) ? image->numSymbols : sym] +=
+						image->instrCounts[i];
+	}
+    order = SortByCount(procCounts, image->numSymbols + 1, &num);
+    fprintf(out, "Procedures:\n%12s %7s  %s\n", "instrs", "%", "name");
+    for (i = 0; i < num; i++) {
+	const char *name = (order[i] == image->numSymbols) ? "[unknown]" :
+					image->symbols[order[i]].name;
+	fprintf(out, "%12u %6.2f%%  %s\n", procCounts[order[i]],
+		100.0 * procCounts[order[i]] / total, name);
+	fprintf(folded, "%s;%s %u\n", program, name, procCounts[order[i]]);
+    }
+    delete [] order;
+    delete [] procCounts;
+
+    // the hottest instructions and basic blocks
+    for (int blocks = 0; blocks <= 1; blocks++) {
+	unsigned int *counts = blocks ? image->blockCounts : image->instrCounts;
+	int top = blocks ? ReportTopBlocks : ReportTopPCs;
+
+	order = SortByCount(counts, image->numInstrs, &num);
+	fprintf(out, "\n%s (hottest %d of %d):\n%12s  %-10s %s\n",
+		blocks ? "Basic blocks" : "Instructions", (num < top) ? num : top,
+		num, blocks ? "entries" : "count", "pc", "where");
+	for (i = 0; i < num && i < top; i++) {
+	    unsigned int pc = order[i] * 4;
+	    sym = image->FindSymbol(pc);
+	    if (sym == -1)
+		fprintf(out, "%12u  0x%08x\n", counts[order[i]], pc);
+	    else
+		fprintf(out, "%12u  0x%08x %s+0x%x\n", counts[order[i]], pc,
+			image->symbols[sym].name, pc - image->symbols[sym].addr);
+	}
+	delete [] order;
+    }
+
+    // loads and stores, by page
+    fprintf(out, "\nMemory references by page:\n%8s %12s %12s\n",
+	    "vpn", "loads", "stores");
+    for (i = 0; i < image->numPages; i++)
+	if (image->loadCounts[i] != 0 || image->storeCounts[i] != 0)
+	    fprintf(out, "%8d %12u %12u\n", i, image->loadCounts[i],
+		    image->storeCounts[i]);
+    fprintf(out, "\n");
+}
+
+//----------------------------------------------------------------------
+// Profiler::Report
+// 	Write out everything we've counted, one section per executable.
+//	Called when Nachos shuts down.
+//----------------------------------------------------------------------
+
+void
+Profiler::Report()
+{
+    char *foldedName = new char[strlen(reportName) + 8];
+    FILE *out, *folded;
+
+    sprintf(foldedName, "%s.folded", reportName);
+    out = fopen(reportName, "w");
+    folded = fopen(foldedName, "w");
+    if (out == NULL || folded == NULL) {
+	printf("Unable to write profile to %s\n", reportName);
+    } else {
+	for (ProfileImage *image = images; image != NULL; image = image->next)
+	    ReportImage(out, folded, image);
+	printf("Profile written to %s and %s\n", reportName, foldedName);
+    }
+    if (out != NULL)
+	fclose(out);
+    if (folded != NULL)
+	fclose(folded);
+    delete [] foldedName;
+}
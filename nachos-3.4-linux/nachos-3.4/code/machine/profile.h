@@ -0,0 +1,93 @@
+// profile.h
+//	Data structures for profiling user programs.
+//
+//	When Nachos is started with -prof, the simulator counts, for each
+//	executable, how many times every instruction and every basic block
+//	was executed, and how many loads and stores went to each virtual
+//	page.  The counts are kept by virtual address, so all processes
+//	running the same executable add up into one profile.
+//
+//	At shutdown the profiler writes a report sorted by hotness, with
+//	addresses symbolized from the "<executable>.sym" file that
+//	coff2noff writes, and a second file in the "folded stacks" format
+//	that flame graph tools read (one "program;procedure count" line per
+//	procedure).
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The start address and name of one procedure of an executable.
+
+class ProfileSymbol {
+  public:
+    unsigned int addr;		// virtual address of the first instruction
+    char *name;
+};
+
+// The counts collected for one executable.
+
+class ProfileImage {
+  public:
+    ProfileImage(char *fileName);	// Start an empty profile, and
+					// load the executable's symbols
+    ~ProfileImage();
+
+    int FindSymbol(unsigned int pc);	// index of the procedure holding
+					// "pc", or -1 if there is none
+
+    char *name;			// the executable's file name
+    ProfileImage *next;		// the next image the profiler knows
+
+    unsigned int *instrCounts;	// executions of each instruction, and
+    unsigned int *blockCounts;	// entries into each basic block,
+				// indexed by (pc / 4)
+    int numInstrs;		// # of entries in each of those
+
+    unsigned int *loadCounts;	// loads from and stores to each
+    unsigned int *storeCounts;	// virtual page, indexed by vpn
+    int numPages;		// # of entries in each of those
+
+    ProfileSymbol *symbols;	// procedures, sorted by address
+    int numSymbols;
+};
+
+// The profiler itself.  The machine simulation calls the Count routines;
+// the kernel tells it which executable is running with SetImage.
+
+class Profiler {
+  public:
+    Profiler(char *fileName);	// Profile into report file "fileName"
+    ~Profiler();
+
+    ProfileImage *FindImage(char *fileName);
+				// Return the profile for executable
+				// "fileName", creating it if need be
+    void SetImage(ProfileImage *image);
+				// Attribute counts to "image" from now on
+
+    void CountInstruction(int pc, bool branch);
+				// Count an instruction about to execute;
+				// "branch" if it has a delay slot
+    void EndBlock() { newBlock = TRUE; }
+				// The next instruction starts a new block
+    void CountLoad(int addr);	// Count a load from, or store to,
+    void CountStore(int addr);	// user virtual address "addr"
+
+    void Report();		// Write the report and the folded stacks
+
+  private:
+    void ReportImage(FILE *out, FILE *folded, ProfileImage *image);
+
+    char *reportName;		// where the report goes
+    ProfileImage *images;	// every executable seen so far
+    ProfileImage *current;	// the one that is running
+
+    int nextPC;			// where a sequential instruction would be
+    int delaySlotPC;		// where the last branch's delay slot is
+    bool newBlock;		// does the next instruction start a block?
+};
+
+#endif // PROFILE_H
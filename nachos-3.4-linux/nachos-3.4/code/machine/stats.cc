@@ -22,6 +22,12 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = 0;
+    numCOWFaults = numCOWCopies = 0;
+    numImageHits = numImageMisses = 0;
+    numZeroHits = numZeroMisses = 0;
+    numPageIns = numPageOuts = 0;
+    pageInTime = pageOutTime = 0;
 }
 
 //----------------------------------------------------------------------
@@ -39,6 +45,16 @@ Statistics::Print()
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    printf("Swap: page-ins %d (%.1f us avg), page-outs %d (%.1f us avg)\n",
+	    numPageIns, (numPageIns > 0) ? pageInTime / numPageIns : 0.0,
+	    numPageOuts, (numPageOuts > 0) ? pageOutTime / numPageOuts : 0.0);
+    printf("TLB: hits %d, misses %d\n", numTLBHits, numTLBMisses);
+    printf("Copy-on-write: faults %d, copies %d\n", numCOWFaults,
+	numCOWCopies);
+    printf("Image cache: hits %d, misses %d\n", numImageHits,
+	numImageMisses);
+    printf("Zeroed pages: pool hits %d, misses %d\n", numZeroHits,
+	numZeroMisses);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
@@ -33,6 +33,18 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageIns;		// number of pages read from swap
+    int numPageOuts;		// number of pages written to swap
+    double pageInTime;		// host microseconds spent on each of
+    double pageOutTime;		// those, in total
+    int numTLBHits;		// number of translations found in the TLB
+    int numTLBMisses;		// number of translations not in the TLB
+    int numCOWFaults;		// number of writes to copy-on-write pages
+    int numCOWCopies;		// number of those that copied the page
+    int numImageHits;		// number of executables run found in,
+    int numImageMisses;		// or not in, the image cache
+    int numZeroHits;		// number of zeroed pages found in,
+    int numZeroMisses;		// or not in, the pool of zeroed pages
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -441,6 +441,21 @@ Exit(int exitCode)
     exit(exitCode);
 }
 
+//----------------------------------------------------------------------
+// HostMicroseconds
+// 	Return the host's time of day, in microseconds.  Only differences
+//	between two readings mean anything.
+//----------------------------------------------------------------------
+
+double
+HostMicroseconds()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
 //----------------------------------------------------------------------
 // RandomInit
 // 	Initialize the pseudo-random number generator.  We use the
@@ -504,3 +519,70 @@ DeallocBoundedArray(char *ptr, int size)
     mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
     delete [] (ptr - pgSize);
 }
+
+//----------------------------------------------------------------------
+// AllocLazyArray
+// 	Return a zero-filled array of "size" bytes, mapped from anonymous
+//	host memory.  The host only commits a page of it the first time
+//	the page is touched, so a large array costs nothing up front, and
+//	only as much resident memory as is actually used.
+//
+//	"size" -- amount of space needed (in bytes)
+//----------------------------------------------------------------------
+
+char *
+AllocLazyArray(size_t size)
+{
+#ifdef MAP_ANONYMOUS
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#else
+    int flags = MAP_PRIVATE | MAP_ANON;
+#endif
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;		// don't reserve swap for all of it
+#endif
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+    return (char *) ptr;
+}
+
+//----------------------------------------------------------------------
+// DeallocLazyArray
+// 	Give an array from AllocLazyArray back to the host.
+//
+//	"ptr" -- the array to be deallocated
+//	"size" -- its size (in bytes), as passed to AllocLazyArray
+//----------------------------------------------------------------------
+
+void
+DeallocLazyArray(char *ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+//----------------------------------------------------------------------
+// MapLazyArray
+// 	Map "size" bytes of the open file "fd", starting at "offset", over
+//	an array from AllocLazyArray.  The mapping is private: the file is
+//	only read, a page at a time as the array is touched, and writes
+//	to the array never reach the file.
+//
+//	Returns FALSE if the host can't map the file; the array is then
+//	unchanged.
+//
+//	"ptr" -- the array to be replaced
+//	"size" -- its size (in bytes)
+//	"fd" -- the file to map
+//	"offset" -- where in the file the array starts; a multiple of
+//		the host page size
+//----------------------------------------------------------------------
+
+bool
+MapLazyArray(char *ptr, int size, int fd, int offset)
+{
+    void *mapped = mmap(ptr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_FIXED, fd, offset);
+
+    return (mapped == (void *) ptr);
+}
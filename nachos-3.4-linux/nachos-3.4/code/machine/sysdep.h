@@ -12,6 +12,7 @@
 #define SYSDEP_H
 
 #include "copyright.h"
+#include <stddef.h>		// for size_t
 
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
@@ -43,6 +44,9 @@ extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 
+// Read the host's clock, for timing how long host operations take
+extern double HostMicroseconds();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
@@ -55,6 +59,15 @@ extern int Random();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Allocate, de-allocate a zero-filled region whose host memory is
+// only committed as it is touched
+extern char *AllocLazyArray(size_t size);
+extern void DeallocLazyArray(char *p, size_t size);
+
+// Replace the contents of such a region, copy-on-write, with part of
+// an open file
+extern bool MapLazyArray(char *p, int size, int fd, int offset);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
@@ -9,11 +9,21 @@
 //	Linear page table -- the virtual page # is used as an index
 //	into the table, to find the physical page #.
 //
+//	Two-level page table -- the virtual page # is split in two: the
+//	high part picks an entry of the page directory, which points to
+//	a second-level table, and the low part is an index into that.
+//
 //	Translation lookaside buffer -- associative lookup in the table
 //	to find an entry with the same virtual page #.  If found,
 //	this entry is used for the translation.
 //	If not, it traps to software with an exception.
 //
+//	The TLB is split into sets of "tlbWays" entries; a virtual page
+//	can only be cached in set (vpn % # of sets).  Each entry is
+//	tagged with the address space ID (ASID) that loaded it, so
+//	entries of different address spaces can live in the TLB at once
+//	and a context switch only has to change the current ASID.
+//
 //	In practice, the TLB is much smaller than the amount of physical
 //	memory (16 entries is common on a machine that has 1000's of
 //	pages).  Thus, there must also be a backup translation scheme
@@ -21,7 +31,7 @@
 //	anything at all about that.
 //
 //	Note that the contents of the TLB are specific to an address space.
-//	If the address space changes, so does the contents of the TLB!
+//	If the address space changes, so does the current ASID!
 //
 // DO NOT CHANGE -- part of the machine emulation
 //
@@ -34,44 +44,6 @@
 #include "addrspace.h"
 #include "system.h"
 
-// Routines for converting Words and Short Words to and from the
-// simulated machine's format of little endian.  These end up
-// being NOPs when the host machine is also little endian (DEC and Intel).
-
-unsigned int
-WordToHost(unsigned int word)
-{
-#ifdef HOST_IS_BIG_ENDIAN
-	register unsigned long result;
-	result = (word >> 24) & 0x000000ff;
-	result |= (word >> 8) & 0x0000ff00;
-	result |= (word << 8) & 0x00ff0000;
-	result |= (word << 24) & 0xff000000;
-	return result;
-#else
-	return word;
-#endif /* HOST_IS_BIG_ENDIAN */
-}
-
-unsigned short
-ShortToHost(unsigned short shortword)
-{
-#ifdef HOST_IS_BIG_ENDIAN
-	register unsigned short result;
-	result = (shortword << 8) & 0xff00;
-	result |= (shortword >> 8) & 0x00ff;
-	return result;
-#else
-	return shortword;
-#endif /* HOST_IS_BIG_ENDIAN */
-}
-
-unsigned int
-WordToMachine(unsigned int word) { return WordToHost(word); }
-
-unsigned short
-ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
-
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into
@@ -90,30 +62,38 @@ bool Machine::ReadMem(int addr, int size, int *value)
 	int data;
 	ExceptionType exception;
 	int physicalAddress;
+	char *hostAddress;
 
-	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
-
-	exception = Translate(addr, &physicalAddress, size, FALSE);
-	if (exception != NoException)
+	if (profiler != NULL)
+		profiler->CountLoad(addr);
+	if ((hostAddress = SoftTranslate(addr, size, FALSE)) == NULL)
 	{
-		machine->RaiseException(exception, addr);
-		return FALSE;
+		DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
+
+		exception = Translate(addr, &physicalAddress, size, FALSE);
+		if (exception != NoException)
+		{
+			machine->RaiseException(exception, addr);
+			return FALSE;
+		}
+		FillSoftTLB(addr, physicalAddress, FALSE);
+		hostAddress = &mainMemory[physicalAddress];
 	}
 	switch (size)
 	{
 	case 1:
-		data = machine->mainMemory[physicalAddress];
+		data = *hostAddress;
 		*value = data;
 		break;
 
 	case 2:
-		data = *(unsigned short *)&machine->mainMemory[physicalAddress];
-		*value = ShortToHost(data);
+		data = LoadShort(hostAddress);
+		*value = data;
 		break;
 
 	case 4:
-		data = *(unsigned int *)&machine->mainMemory[physicalAddress];
-		*value = WordToHost(data);
+		data = LoadWord(hostAddress);
+		*value = data;
 		break;
 
 	default:
@@ -141,40 +121,339 @@ bool Machine::WriteMem(int addr, int size, int value)
 {
 	ExceptionType exception;
 	int physicalAddress;
+	char *hostAddress;
 
-	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
-
-	exception = Translate(addr, &physicalAddress, size, TRUE);
-	if (exception != NoException)
+	if (profiler != NULL)
+		profiler->CountStore(addr);
+	if ((hostAddress = SoftTranslate(addr, size, TRUE)) == NULL)
 	{
-		machine->RaiseException(exception, addr);
-		return FALSE;
+		DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+
+		exception = Translate(addr, &physicalAddress, size, TRUE);
+		if (exception != NoException)
+		{
+			machine->RaiseException(exception, addr);
+			return FALSE;
+		}
+		FillSoftTLB(addr, physicalAddress, TRUE);
+		hostAddress = &mainMemory[physicalAddress];
 	}
 	switch (size)
 	{
 	case 1:
-		machine->mainMemory[physicalAddress] = (unsigned char)(value & 0xff);
+		*hostAddress = (unsigned char)(value & 0xff);
 		break;
 
 	case 2:
-		*(unsigned short *)&machine->mainMemory[physicalAddress] = ShortToMachine((unsigned short)(value & 0xffff));
+		StoreShort(hostAddress, (unsigned short)(value & 0xffff));
 		break;
 
 	case 4:
-		*(unsigned int *)&machine->mainMemory[physicalAddress] = WordToMachine((unsigned int)value);
+		StoreWord(hostAddress, (unsigned int)value);
 		break;
 
 	default:
 		ASSERT(FALSE);
 	}
+	InvalidateDecodedPage((hostAddress - mainMemory) / PageSize); // code may have changed
 
 	return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::FillSoftTLB
+//      Remember, in the software TLB, that the page holding virtual
+//	address "virtAddr" is at "physAddr" for reads (or for writes, if
+//	"writing").  Only called once Translate has succeeded, and so has
+//	already set the use (and dirty) bit that later hits would set.
+//
+//	While address tracing is on, we don't cache anything, so that
+//	every reference still goes through Translate and gets printed.
+//	Nor do we with a TLB: every reference has to reach it, to keep
+//	its hit counts and LRU order exact.
+//----------------------------------------------------------------------
+
+void Machine::FillSoftTLB(int virtAddr, int physAddr, bool writing)
+{
+	unsigned int vpn = (unsigned)virtAddr / PageSize;
+	SoftTLBEntry *entry = &softTLB[writing][vpn & (SoftTLBSize - 1)];
+
+	if (DebugIsEnabled('a') || tlb != NULL)
+		return;
+	entry->tag = vpn * PageSize;
+	entry->page = &mainMemory[(physAddr / PageSize) * PageSize];
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushSoftTLB
+//      Invalidate every entry of the software TLB, because the
+//	translations it caches may no longer hold.
+//----------------------------------------------------------------------
+
+void Machine::FlushSoftTLB()
+{
+	for (int i = 0; i < SoftTLBSize; i++)
+	{
+		softTLB[FALSE][i].tag = SoftTLBInvalid;
+		softTLB[TRUE][i].tag = SoftTLBInvalid;
+	}
+}
+
+//----------------------------------------------------------------------
+// Machine::ConfigureTLB
+//      Replace the TLB with an empty one of "size" entries, organized
+//	as sets of "ways" entries each ("ways" == "size" makes it fully
+//	associative, 1 makes it direct mapped).
+//
+//	"policy" -- how LoadTLB chooses the entry of a set to replace
+//----------------------------------------------------------------------
+
+void Machine::ConfigureTLB(int size, int ways, TLBPolicy policy)
+{
+	ASSERT(size > 0 && ways > 0 && (size % ways) == 0);
+
+	if (tlb != NULL)
+	{
+		delete[] tlb;
+		delete[] tlbASID;
+		delete[] tlbLastUse;
+		delete[] tlbSource;
+	}
+	tlbSize = size;
+	tlbWays = ways;
+	tlbPolicy = policy;
+	tlb = new TranslationEntry[size];
+	tlbASID = new int[size];
+	tlbLastUse = new unsigned int[size];
+	tlbSource = new TranslationEntry *[size];
+	for (int i = 0; i < size; i++)
+	{
+		tlb[i].valid = FALSE;
+		tlbASID[i] = -1;
+		tlbLastUse[i] = 0;
+		tlbSource[i] = NULL;
+	}
+	tlbClock = 0;
+	currentASID = 0;
+}
+
+//----------------------------------------------------------------------
+// Machine::LookupTLB
+//      Search the set that "vpn" maps to for a valid entry of the
+//	current address space, and mark it as just used.
+//
+//	Returns the index of the entry in "tlb", or -1 on a TLB miss.
+//----------------------------------------------------------------------
+
+int Machine::LookupTLB(unsigned int vpn)
+{
+	int first = (vpn % (tlbSize / tlbWays)) * tlbWays;
+
+	for (int i = first; i < first + tlbWays; i++)
+		if (tlb[i].valid && (tlb[i].virtualPage == vpn) &&
+				(tlbASID[i] == currentASID))
+		{
+			tlbLastUse[i] = ++tlbClock;
+			return i;
+		}
+	return -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::SetASID
+//      Make "asid" the current address space ID.  Called by the kernel
+//	on a context switch instead of flushing the TLB.
+//----------------------------------------------------------------------
+
+void Machine::SetASID(int asid)
+{
+	ASSERT(asid >= 0 && asid < NumASIDs);
+	currentASID = asid;
+}
+
+//----------------------------------------------------------------------
+// Machine::LoadTLB
+//      Copy the translation "entry" into the TLB, tagged with the
+//	current ASID.  The kernel calls this to refill the TLB after a
+//	miss.  An invalid entry of the set is used if there is one;
+//	otherwise the replacement policy picks the entry to evict.
+//
+//	The copy collects the use and dirty bits; they are written back
+//	to "entry" (see WriteBackTLB) when the TLB entry is replaced or
+//	flushed, so the page table stays good enough for the pager.
+//----------------------------------------------------------------------
+
+void Machine::LoadTLB(TranslationEntry *entry)
+{
+	int first = (entry->virtualPage % (tlbSize / tlbWays)) * tlbWays;
+	int victim = -1;
+
+	for (int i = first; i < first + tlbWays; i++)
+		if (!tlb[i].valid)
+		{
+			victim = i;
+			break;
+		}
+	if (victim == -1)
+	{
+		if (tlbPolicy == TLBReplaceRandom)
+			victim = first + Random() % tlbWays;
+		else
+		{
+			victim = first;
+			for (int i = first + 1; i < first + tlbWays; i++)
+				if (tlbLastUse[i] < tlbLastUse[victim])
+					victim = i;
+		}
+	}
+	DEBUG('a', "Loading vpn %d (asid %d) into TLB entry %d\n",
+				entry->virtualPage, currentASID, victim);
+	WriteBackTLB(victim);
+	tlb[victim] = *entry;
+	tlbASID[victim] = currentASID;
+	tlbLastUse[victim] = ++tlbClock;
+	tlbSource[victim] = entry;
+}
+
+//----------------------------------------------------------------------
+// Machine::WriteBackTLB
+//      Copy the use and dirty bits that TLB entry "i" collected into the
+//	page table entry it was loaded from, as a real kernel would when
+//	it takes an entry out of the TLB.  The entry's use bit starts over.
+//----------------------------------------------------------------------
+
+void Machine::WriteBackTLB(int i)
+{
+	if (!tlb[i].valid || tlbSource[i] == NULL)
+		return;
+	tlbSource[i]->use |= tlb[i].use;
+	tlbSource[i]->dirty |= tlb[i].dirty;
+	tlb[i].use = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::SyncTLB
+//      Bring the use and dirty bits of every page table entry that is in
+//	the TLB up to date, so that the kernel can inspect (or clear) them.
+//----------------------------------------------------------------------
+
+void Machine::SyncTLB()
+{
+	if (tlb == NULL)
+		return;
+	for (int i = 0; i < tlbSize; i++)
+		WriteBackTLB(i);
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTLB
+//      Invalidate all the TLB entries loaded for address space "asid",
+//	for instance because the address space is going away and its
+//	ASID may be handed out again.  Their use and dirty bits are
+//	written back first.
+//----------------------------------------------------------------------
+
+void Machine::FlushTLB(int asid)
+{
+	for (int i = 0; i < tlbSize; i++)
+		if (tlbASID[i] == asid)
+		{
+			WriteBackTLB(i);
+			tlb[i].valid = FALSE;
+		}
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTLBPage
+//      Invalidate the TLB entry loaded for virtual page "vpn" of address
+//	space "asid", if there is one, for instance because the kernel
+//	changed the page's translation.
+//----------------------------------------------------------------------
+
+void Machine::FlushTLBPage(int asid, unsigned int vpn)
+{
+	int first = (vpn % (tlbSize / tlbWays)) * tlbWays;
+
+	for (int i = first; i < first + tlbWays; i++)
+		if (tlb[i].valid && (tlb[i].virtualPage == vpn) &&
+				(tlbASID[i] == asid))
+		{
+			WriteBackTLB(i);
+			tlb[i].valid = FALSE;
+		}
+}
+
+//----------------------------------------------------------------------
+// PageTable::PageTable
+// 	Create a two-level page table covering "size" virtual pages,
+//	with an empty directory.
+//----------------------------------------------------------------------
+
+PageTable::PageTable(unsigned int size)
+{
+	unsigned int numDirEntries = divRoundUp(size, PageTableChunk);
+
+	numPages = size;
+	directory = new PageTableEntry *[numDirEntries];
+	for (unsigned int i = 0; i < numDirEntries; i++)
+		directory[i] = NULL;
+	numChunks = 0;
+}
+
+//----------------------------------------------------------------------
+// PageTable::~PageTable
+// 	De-allocate the directory and every second-level table.
+//----------------------------------------------------------------------
+
+PageTable::~PageTable()
+{
+	unsigned int numDirEntries = divRoundUp(numPages, PageTableChunk);
+
+	for (unsigned int i = 0; i < numDirEntries; i++)
+		delete [] directory[i];
+	delete [] directory;
+}
+
+//----------------------------------------------------------------------
+// PageTable::Entry
+// 	Return the entry for virtual page "vpn", allocating the
+//	second-level table it is in if there is none yet.  New entries are
+//	invalid, and have no copy-on-write or swap information.
+//----------------------------------------------------------------------
+
+PageTableEntry *
+PageTable::Entry(unsigned int vpn)
+{
+	ASSERT(vpn < numPages);
+	PageTableEntry *chunk = directory[vpn / PageTableChunk];
+
+	if (chunk == NULL)
+	{
+		DEBUG('a', "New second-level page table for vpn %d\n", vpn);
+		chunk = new PageTableEntry[PageTableChunk];
+		for (int i = 0; i < PageTableChunk; i++)
+		{
+			chunk[i].virtualPage =
+				vpn - (vpn % PageTableChunk) + i;
+			chunk[i].physicalPage = 0;
+			chunk[i].valid = FALSE;
+			chunk[i].readOnly = FALSE;
+			chunk[i].use = FALSE;
+			chunk[i].dirty = FALSE;
+			chunk[i].copyOnWrite = FALSE;
+			chunk[i].swapSlot = -1;
+		}
+		directory[vpn / PageTableChunk] = chunk;
+		numChunks++;
+	}
+	return &chunk[vpn % PageTableChunk];
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using
-//	either a page table or a TLB.  Check for alignment and all sorts
+//	either a linear page table, a two-level page table, or a TLB.
+//	Check for alignment and all sorts
 //	of other errors, and if everything is ok, set the use/dirty bits in
 //	the translation table entry, and store the translated physical
 //	address in "physAddr".  If there was an error, returns the type
@@ -203,16 +482,34 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 		return AddressErrorException;
 	}
 
-	// we must have either a TLB or a page table, but not both!
-	ASSERT(tlb == NULL || pageTable == NULL);
-	ASSERT(tlb != NULL || pageTable != NULL);
+	// we must have exactly one of a TLB, a linear page table, or a
+	// two-level page table
+	ASSERT((tlb != NULL) + (pageTable != NULL) + (twoLevelTable != NULL)
+		   == 1);
+	i = -1;
 
 	// calculate the virtual page number, and offset within the page,
 	// from the virtual address
 	vpn = (unsigned)virtAddr / PageSize;
 	offset = (unsigned)virtAddr % PageSize;
 
-	if (tlb == NULL)
+	if (twoLevelTable != NULL)
+	{ // => two-level page table => vpn picks a directory entry, and an
+	  // entry in the second-level table it points to
+		if (vpn >= twoLevelTable->GetNumPages())
+		{
+			DEBUG('a', "virtual page # %d too large for page table size %d!\n",
+						virtAddr, twoLevelTable->GetNumPages());
+			return AddressErrorException;
+		}
+		entry = twoLevelTable->Lookup(vpn);
+		if (entry == NULL || !entry->valid)
+		{
+			DEBUG('a', "virtual page # %d not mapped!\n", vpn);
+			return PageFaultException;
+		}
+	}
+	else if (tlb == NULL)
 	{ // => page table => vpn is index into table
 		if (vpn >= pageTableSize)
 		{
@@ -230,19 +527,16 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 	}
 	else
 	{
-		for (entry = NULL, i = 0; i < TLBSize; i++)
-			if (tlb[i].valid && (tlb[i].virtualPage == vpn))
-			{
-				entry = &tlb[i]; // FOUND!
-				break;
-			}
-		if (entry == NULL)
+		if ((i = LookupTLB(vpn)) == -1)
 		{ // not found
 			DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+			stats->numTLBMisses++;
 			return PageFaultException; // really, this is a TLB fault,
 																 // the page may be in memory,
 																 // but not in the TLB
 		}
+		stats->numTLBHits++;
+		entry = &tlb[i]; // FOUND!
 	}
 
 	if (entry->readOnly && writing)
@@ -254,16 +548,16 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 
 	// if the pageFrame is too big, there is something really wrong!
 	// An invalid translation was loaded into the page table or TLB.
-	if (pageFrame >= NumPhysPages)
+	if (pageFrame >= (unsigned)numPhysPages)
 	{
-		DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
+		DEBUG('a', "*** frame %d > %d!\n", pageFrame, numPhysPages);
 		return BusErrorException;
 	}
 	entry->use = TRUE; // set the use, dirty bits
 	if (writing)
 		entry->dirty = TRUE;
 	*physAddr = pageFrame * PageSize + offset;
-	ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
+	ASSERT((*physAddr >= 0) && ((*physAddr + size) <= memorySize));
 	DEBUG('a', "phys addr = 0x%x\n", *physAddr);
 	return NoException;
 }
@@ -42,4 +42,52 @@ class TranslationEntry {
 			// page is modified.
 };
 
+// An entry of a two-level page table.  Besides the translation, it has
+// room for the operating system's own information about the page, which
+// the hardware ignores -- like the spare bits of a real page table entry.
+
+class PageTableEntry : public TranslationEntry {
+  public:
+    bool copyOnWrite;	// Shared read-only until written; then the
+			// kernel copies it.
+    int swapSlot;	// Where the kernel saved the page while it was out
+			// of memory; -1 if nowhere.
+};
+
+// A two-level page table: a directory, with one pointer for every
+// "PageTableChunk" virtual pages, to second-level tables of entries.
+// A second-level table only exists once one of its pages has been
+// given an entry, so the memory a page table takes grows with the
+// pages actually mapped, not with the size of the virtual address
+// space -- a program with a big gap between its heap and its stack
+// costs nothing for the gap.
+
+#define PageTableChunk	32	// entries in each second-level table
+
+class PageTable {
+  public:
+    PageTable(unsigned int size);	// Create a table for virtual
+					// pages 0 .. size-1, with
+					// no entries
+    ~PageTable();
+
+    unsigned int GetNumPages() { return numPages; }
+    PageTableEntry *Lookup(unsigned int vpn) {
+	PageTableEntry *chunk = directory[vpn / PageTableChunk];
+	return (chunk == NULL) ? NULL : &chunk[vpn % PageTableChunk];
+    }					// The entry for "vpn", NULL if it
+					// has none
+    PageTableEntry *Entry(unsigned int vpn);
+					// The entry for "vpn", creating
+					// it (invalid) if need be
+    int GetNumChunks() { return numChunks; }
+					// # of second-level tables
+
+  private:
+    PageTableEntry **directory;		// the second-level tables, NULL
+					// where there is none
+    unsigned int numPages;		// # of virtual pages covered
+    int numChunks;			// # of second-level tables
+};
+
 #endif
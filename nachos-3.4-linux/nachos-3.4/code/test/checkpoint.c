@@ -0,0 +1,32 @@
+#include "syscall.h"
+
+int array[1024];
+
+void sum(){
+	int i, total = 0;
+
+	for (i = 0; i < 1024; i++) total += array[i];
+	Exit(total);
+}
+
+int main()
+{
+	int i, ret;
+	SpaceId pid;
+
+	/* warm up: the state we want every run to start from */
+	for (i = 0; i < 1024; i++)
+		array[i] = i;
+	pid = Fork(sum);
+
+	/* run once with "-x checkpoint", then again with
+	 * "-restore warm.ckpt" to continue from here
+	 */
+	ret = Checkpoint("warm.ckpt");
+	if (ret == 1)
+		Write("resumed from checkpoint\n", 24, ConsoleOutput);
+	else if (ret == 0)
+		Write("checkpoint saved\n", 17, ConsoleOutput);
+
+	Exit(Join(pid));
+}
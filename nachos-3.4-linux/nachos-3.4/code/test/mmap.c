@@ -0,0 +1,39 @@
+#include "syscall.h"
+
+/* Map a file into memory, change it in place, and read it back through
+ * Read to see the change made it to the file.
+ */
+
+#define TEXT	"memory-mapped files write back on unmap\n"
+#define LENGTH	40
+
+int main()
+{
+	OpenFileId fd;
+	char *text;
+	char buf[LENGTH];
+	int i;
+
+	Create("mmap.dat");
+	fd = Open("mmap.dat");
+	if (fd < 0)
+		Exit(-1);
+	Write(TEXT, LENGTH, fd);
+
+	text = Mmap(fd);
+	Close(fd);		/* the mapping keeps the file open */
+	if (text == (char *) -1)
+		Exit(-2);
+	for (i = 0; i < LENGTH; i++)
+		if (text[i] >= 'a' && text[i] <= 'z')
+			text[i] = text[i] - 'a' + 'A';
+	if (Munmap(text) < 0)
+		Exit(-3);
+
+	fd = Open("mmap.dat");
+	if (fd < 0 || Read(buf, LENGTH, fd) != LENGTH)
+		Exit(-4);
+	Write(buf, LENGTH, ConsoleOutput);
+	Close(fd);
+	Exit(0);
+}
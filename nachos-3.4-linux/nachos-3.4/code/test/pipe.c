@@ -0,0 +1,59 @@
+#include "syscall.h"
+
+/* A three-stage pipeline: a producer writes a line of text into one pipe,
+ * a filter copies it to a second pipe in upper case, and the parent
+ * prints what comes out.  Each stage is a separate process; the data
+ * never goes near the file system.
+ */
+
+#define TEXT	"text streamed through two pipes\n"
+#define LENGTH	32
+
+OpenFileId first[2], second[2];	/* [0] is read from, [1] written to */
+
+void producer()
+{
+	Close(first[0]);
+	Close(second[0]);
+	Close(second[1]);
+	Write(TEXT, LENGTH, first[1]);
+	Exit(0);		/* closes first[1]: the filter sees the end */
+}
+
+void filter()
+{
+	char c;
+
+	Close(first[1]);
+	Close(second[0]);
+	while (Read(&c, 1, first[0]) == 1) {
+		if (c >= 'a' && c <= 'z')
+			c = c - 'a' + 'A';
+		Write(&c, 1, second[1]);
+	}
+	Exit(0);
+}
+
+int main()
+{
+	char buf[LENGTH];
+	int n, total;
+
+	if (Pipe(first) < 0 || Pipe(second) < 0)
+		Exit(-1);
+	Fork(producer);
+	Fork(filter);
+
+	/* only the children use these ends: close them, or we would never
+	 * see the end of the data */
+	Close(first[0]);
+	Close(first[1]);
+	Close(second[1]);
+
+	total = 0;
+	while ((n = Read(buf, LENGTH, second[0])) > 0) {
+		Write(buf, n, ConsoleOutput);
+		total += n;
+	}
+	Exit(total);
+}
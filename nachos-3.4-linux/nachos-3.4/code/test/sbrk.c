@@ -0,0 +1,43 @@
+#include "syscall.h"
+
+/* 256 bytes of stack for each call, so that the stack must grow */
+int recurse(int n)
+{
+	int frame[64];
+	int i, total;
+
+	for (i = 0; i < 64; i++)
+		frame[i] = n;
+	total = (n > 0) ? recurse(n - 1) : 0;
+	for (i = 0; i < 64; i++)
+		total += frame[i];
+	return total;
+}
+
+int main()
+{
+	int *heap;
+	int i, total = 0;
+
+	/* the array comes from the heap, not from a static declaration */
+	heap = (int *) Sbrk(1024 * sizeof(int));
+	if (heap == (int *) -1)
+		Exit(-1);
+	for (i = 0; i < 1024; i++)
+		total += heap[i];		/* all zeroes to begin with */
+	if (total != 0)
+		Exit(-2);
+	for (i = 0; i < 1024; i++)
+		heap[i] = i;
+	for (i = 0; i < 1024; i++)
+		total += heap[i];
+	if (total != 1023 * 1024 / 2)
+		Exit(-3);
+
+	/* 32 calls deep: 8K of stack, well past UserStackSize */
+	if (recurse(31) != 64 * (31 * 32 / 2))
+		Exit(-4);
+
+	Write("heap and stack grew\n", 20, ConsoleOutput);
+	Exit(0);
+}
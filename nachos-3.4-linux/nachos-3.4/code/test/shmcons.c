@@ -0,0 +1,36 @@
+#include "syscall.h"
+
+/* The consumer of a producer/consumer pair (see shmprod.c): sums the
+ * numbers the producer puts in the shared ring buffer, and exits with
+ * the total.
+ */
+
+#define SLOTS	16
+#define ITEMS	200
+
+/* must match shmprod.c */
+struct ring {
+	int head;		/* # of items put in */
+	int tail;		/* # of items taken out */
+	int slots[SLOTS];
+};
+
+int main()
+{
+	struct ring *ring;
+	int i, total = 0;
+
+	ring = (struct ring *) ShmAttach("ring");
+	if (ring == (struct ring *) -1)
+		Exit(-1);
+
+	for (i = 0; i < ITEMS; i++) {
+		while (ring->tail == ring->head)
+			Yield();	/* empty: let the producer get ahead */
+		total += ring->slots[ring->tail % SLOTS];
+		ring->tail++;
+	}
+
+	ShmDetach((char *) ring);
+	Exit(total);
+}
@@ -0,0 +1,51 @@
+#include "syscall.h"
+
+/* The producer of a producer/consumer pair (see shmcons.c) passing
+ * numbers through a ring buffer in shared memory: once the segment is
+ * attached, no data goes through the kernel.  The consumer runs in a
+ * forked child, which Execs it.
+ */
+
+#define SLOTS	16
+#define ITEMS	200
+
+/* must match shmcons.c */
+struct ring {
+	int head;		/* # of items put in */
+	int tail;		/* # of items taken out */
+	int slots[SLOTS];
+};
+
+void consume()
+{
+	Exec("../test/shmcons");
+}
+
+int main()
+{
+	struct ring *ring;
+	SpaceId consumer;
+	int i, total;
+
+	if (ShmCreate("ring", sizeof(struct ring)) < 0)
+		Exit(-1);
+	ring = (struct ring *) ShmAttach("ring");
+	if (ring == (struct ring *) -1)
+		Exit(-2);
+	consumer = Fork(consume);
+	if (consumer < 0)
+		Exit(-3);
+
+	for (i = 1; i <= ITEMS; i++) {
+		while (ring->head - ring->tail == SLOTS)
+			Yield();	/* full: let the consumer catch up */
+		ring->slots[ring->head % SLOTS] = i;
+		ring->head++;
+	}
+
+	total = Join(consumer);
+	ShmDetach((char *) ring);
+	if (total == ITEMS * (ITEMS + 1) / 2)
+		Write("consumer got every item\n", 24, ConsoleOutput);
+	Exit(total);
+}
@@ -9,7 +9,7 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-s -cpu <core> -batch -mem <size> -prof <file> -tlb <n> -tlbways <n> -tlbrepl <policy> -vmrepl <policy> -x <nachos file> -restore <file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
@@ -22,7 +22,22 @@
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -cpu selects the interpreter core for user programs: "switch"
+//	(the default), "threaded", or "block" (basic-block cache)
+//    -batch runs user code up to the next pending interrupt before
+//	advancing the clock, instead of ticking after every instruction
+//    -mem sets the size of physical memory, in bytes or with a K, M or G
+//	suffix (ex: -mem 64M), less than 2G; the default is 32 pages
+//    -prof profiles user programs, writing a report to <file> and
+//	flame graph input ("folded stacks") to <file>.folded at shutdown
+//    -tlb sets the number of TLB entries (USE_TLB only)
+//    -tlbways sets the TLB associativity; the default is fully associative
+//    -tlbrepl selects TLB replacement: "lru" (the default) or "random"
+//    -vmrepl selects physical page replacement (VM only): "fifo",
+//	"clock" (the default) or "lru"
 //    -x runs a user program
+//    -restore resumes the user programs saved in <file> by the
+//	Checkpoint system call; physical memory is sized to match
 //    -c tests the console
 //
 //  FILESYS
@@ -71,6 +86,7 @@ extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 #endif
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void RestoreCheckpoint(char *fileName);
 extern void MailTest(int networkID);
 
 //----------------------------------------------------------------------
@@ -143,6 +159,10 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-restore")) {	// resume a checkpoint
+	    ASSERT(argc > 1);
+            RestoreCheckpoint(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-c")) {      // test the console
 	    if (argc == 1)
 	        ConsoleTest(NULL, NULL);
@@ -150,39 +150,34 @@ Scheduler::Print()
 
 //----------------------------------------------------------------------
 // Scheduler::UnSchedule(int pid)
-//  Return the thread with given pid from the ready list by removing it
+//  Return the thread with given pid from the ready list by removing it;
+//  NULL, leaving the ready list as it was, if it isn't there (it is
+//  blocked).
 //
 //  "pid" is the process id of the thread we want to unschedule
 //----------------------------------------------------------------------
 Thread *
 Scheduler::UnSchedule(int pid)
 {
-    ASSERT(!readyList->IsEmpty())
-
     // iterate through the items in the ready list by calling remove
     List *tempList = new List();
     Thread *removed_thread = (Thread *) readyList->Remove();
-    while(removed_thread != NULL)
+    while(removed_thread != NULL &&
+          removed_thread->space->pcb->GetPID() != pid)
     {
-        // removed thread is the unscheduler thread
-        if (removed_thread->space->pcb->GetPID() == pid)
-        {
-            // put back the removed ready threads in the correct order
-            while(!tempList->IsEmpty())
-            {
-                void *item = tempList->Remove();
-                readyList->Prepend(item);
-            }
-            delete tempList;
-            return removed_thread;
-        }
         // store removed item in the temp list
         tempList->Prepend((void *) removed_thread);
 
         removed_thread = (Thread *) readyList->Remove();
     }
-    return NULL;
-    // TODO: Handle the cases where there can be random interrupts leading
-    // to the killed process not being in the ready list
+
+    // put back the removed ready threads in the correct order
+    while(!tempList->IsEmpty())
+    {
+        void *item = tempList->Remove();
+        readyList->Prepend(item);
+    }
+    delete tempList;
+    return removed_thread;
 }
 #endif
\ No newline at end of file
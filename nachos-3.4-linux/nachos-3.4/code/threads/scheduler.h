@@ -29,6 +29,8 @@ class Scheduler {
     void Print();			// Print contents of ready list
     Thread* UnSchedule(int pid);  // remove the thread with given pid
                                   // from scheduler and return its pointer
+    void MapReady(VoidFunctionPtr func) { readyList->Mapcar(func); }
+				// Apply "func" to each ready thread, in order
 
   private:
     List *readyList;  		// queue of threads that are ready to run,
@@ -8,6 +8,11 @@
 #include "copyright.h"
 #include "system.h"
 
+#ifdef USER_PROGRAM
+#include "checkpoint.h"
+#include <limits.h>
+#endif
+
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
 
@@ -29,13 +34,24 @@ SynchDisk   *synchDisk;
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+Profiler *profiler;
 MemoryManager *mm;
+TextCache *textCache;
+ImageCache *imageCache;
+SegmentTable *segmentTable;
 PCBManager *pcbManager;
+#ifdef USE_TLB
+BitMap *asidMap;
+#endif
 
 VNodeManager *vnm;
 OpenFileTable *oft;
 #endif
 
+#ifdef VM
+Pager *pager;
+#endif
+
 #ifdef NETWORK
 PostOffice *postOffice;
 #endif
@@ -69,6 +85,51 @@ TimerInterruptHandler(int dummy)
 	interrupt->YieldOnReturn();
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// ParseMemorySize
+// 	Convert a memory size given on the command line, in bytes or
+//	with a "K", "M" or "G" suffix (ex: "64M"), to a number of bytes.
+//	Returns 0 if "arg" isn't a size, or is more memory than the
+//	simulator can address (MaxMemorySize).
+//----------------------------------------------------------------------
+
+// Physical addresses are ints, so this is as much memory as there can be
+#define MaxMemorySize	((long long) INT_MAX)
+
+static long long
+ParseMemorySize(char *arg)
+{
+    long long size = 0;
+    char *suffix = arg;
+
+    for (; *suffix >= '0' && *suffix <= '9'; suffix++) {
+	size = size * 10 + (*suffix - '0');
+	if (size > MaxMemorySize)
+	    return 0;
+    }
+    if (suffix == arg)
+	return 0;
+    switch (*suffix) {
+      case 'k': case 'K':
+	size <<= 10;
+	suffix++;
+	break;
+      case 'm': case 'M':
+	size <<= 20;
+	suffix++;
+	break;
+      case 'g': case 'G':
+	size <<= 30;
+	suffix++;
+	break;
+    }
+    if (*suffix != '\0' || size > MaxMemorySize)
+	return 0;			// junk after the number, or too big
+    return size;
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -88,6 +149,19 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    CPUCore cpuCore = SwitchCore;	// interpreter core for user programs
+    bool batchTicks = FALSE;		// batch clock ticks between interrupts?
+    char *profileName = NULL;		// where to write the profile
+    int physPages = DefaultPhysPages;	// size of physical memory
+#ifdef USE_TLB
+    int tlbSize = TLBSize;		// TLB entries
+    int tlbWays = 0;			// TLB entries per set; 0 means all
+    TLBPolicy tlbPolicy = TLBReplaceLRU;	// TLB replacement policy
+#endif
+#ifdef VM
+    PageReplacement pageReplacement = PageReplaceClock;
+					// physical page replacement policy
+#endif
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -116,6 +190,69 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-cpu")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "switch"))
+		cpuCore = SwitchCore;
+	    else if (!strcmp(*(argv + 1), "threaded"))
+		cpuCore = ThreadedCore;
+	    else if (!strcmp(*(argv + 1), "block"))
+		cpuCore = BlockCore;
+	    else
+		ASSERT(FALSE);		// unknown interpreter core
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-batch"))
+	    batchTicks = TRUE;
+	else if (!strcmp(*argv, "-mem")) {
+	    ASSERT(argc > 1);
+	    physPages = (int) (ParseMemorySize(*(argv + 1)) / PageSize);
+	    ASSERT(physPages > 0);	// not a size, or out of range
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-restore")) {
+	    ASSERT(argc > 1);
+	    physPages = CheckpointPhysPages(*(argv + 1));
+	    if (physPages == 0)		// unusable; main will complain
+		physPages = DefaultPhysPages;
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-prof")) {
+	    ASSERT(argc > 1);
+	    profileName = *(argv + 1);
+	    argCount = 2;
+	}
+#ifdef USE_TLB
+	else if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    tlbSize = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbways")) {
+	    ASSERT(argc > 1);
+	    tlbWays = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbrepl")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "lru"))
+		tlbPolicy = TLBReplaceLRU;
+	    else if (!strcmp(*(argv + 1), "random"))
+		tlbPolicy = TLBReplaceRandom;
+	    else
+		ASSERT(FALSE);		// unknown replacement policy
+	    argCount = 2;
+	}
+#endif
+#ifdef VM
+	else if (!strcmp(*argv, "-vmrepl")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		pageReplacement = PageReplaceFIFO;
+	    else if (!strcmp(*(argv + 1), "clock"))
+		pageReplacement = PageReplaceClock;
+	    else if (!strcmp(*(argv + 1), "lru"))
+		pageReplacement = PageReplaceLRU;
+	    else
+		ASSERT(FALSE);		// unknown replacement policy
+	    argCount = 2;
+	}
+#endif
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -153,8 +290,17 @@ Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg);	// this must come first
+    machine = new Machine(debugUserProg, cpuCore, batchTicks, physPages);	// this must come first
+#ifdef USE_TLB
+    machine->ConfigureTLB(tlbSize, (tlbWays == 0) ? tlbSize : tlbWays,
+			  tlbPolicy);
+    asidMap = new BitMap(NumASIDs);
+#endif
+    profiler = (profileName != NULL) ? new Profiler(profileName) : NULL;
     mm = new MemoryManager();
+    textCache = new TextCache();
+    imageCache = new ImageCache(ImageCacheSize);
+    segmentTable = new SegmentTable();
     pcbManager = new PCBManager(MAX_PROCESSES);
 
     vnm = new VNodeManager();
@@ -169,6 +315,10 @@ Initialize(int argc, char **argv)
     fileSystem = new FileSystem(format);
 #endif
 
+#ifdef VM
+    pager = new Pager(pageReplacement);	// its swap file needs fileSystem
+#endif
+
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
 #endif
@@ -186,7 +336,15 @@ Cleanup()
     delete postOffice;
 #endif
     
+#ifdef VM
+    delete pager;
+#endif
+
 #ifdef USER_PROGRAM
+    if (profiler != NULL) {
+	profiler->Report();
+	delete profiler;
+    }
     delete machine;
 #endif
 
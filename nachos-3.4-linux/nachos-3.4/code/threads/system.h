@@ -31,14 +31,25 @@ extern Timer *timer;				// the hardware alarm clock
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "profile.h"
 #include "memorymanager.h"
 #include "pcbmanager.h"
+#include "textcache.h"
+#include "imagecache.h"
+#include "sharedmem.h"
 
 #define MAX_PROCESSES 10
 
 extern Machine *machine;	// user program memory and registers
+extern Profiler *profiler;	// user program profile, NULL unless -prof
 extern MemoryManager *mm;
+extern TextCache *textCache;	// code pages shared between processes
+extern ImageCache *imageCache;	// executables run recently
+extern SegmentTable *segmentTable;	// shared memory segments
 extern PCBManager *pcbManager;
+#ifdef USE_TLB
+extern BitMap *asidMap;		// TLB address space IDs in use
+#endif
 
 // file access data structures
 #include "vnodemanager.h"
@@ -52,6 +63,12 @@ extern VNodeManager *vnm;
 extern OpenFileTable *oft;
 #endif
 
+#ifdef VM
+#include "pager.h"
+
+extern Pager *pager;		// brings in user pages on demand
+#endif
+
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
 #include "filesys.h"
 extern FileSystem  *fileSystem;
@@ -125,6 +125,8 @@ class Thread {
   public:
     void SaveUserState();		// save user-level register state
     void RestoreUserState();		// restore user-level register state
+    int ReadUserRegister(int num) { return userRegisters[num]; }
+					// saved value of a user register
 
     AddrSpace *space;			// User code this thread is running.
 #endif
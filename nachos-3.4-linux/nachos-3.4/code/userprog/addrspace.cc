@@ -18,32 +18,10 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
 
-//----------------------------------------------------------------------
-// SwapHeader
-// 	Do little endian to big endian conversion on the bytes in the
-//	object file header, in case the file was generated on a little
-//	endian machine, and we're now running on a big endian machine.
-//----------------------------------------------------------------------
-
-static void SwapHeader(NoffHeader *noffH)
-{
-    noffH->noffMagic = WordToHost(noffH->noffMagic);
-    noffH->code.size = WordToHost(noffH->code.size);
-    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
-    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
-    noffH->initData.size = WordToHost(noffH->initData.size);
-    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
-    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
-    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
-    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
-    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
-}
-
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -56,86 +34,148 @@ static void SwapHeader(NoffHeader *noffH)
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uni-programming, and we have a single unsegmented page table
 //
-//	"executable" is the file containing the object code to load into memory
+//	With virtual memory (VM), nothing is loaded here: every page
+//	starts out invalid, and is read in from the executable (or
+//	zero-filled) by the pager the first time it is touched, and from
+//	the swap file after that, if it was written to.  So
+//	starting a program takes the same time whatever its size, and
+//	the program may be bigger than physical memory.
+//
+//	Either way, only the program and the stack are part of the address
+//	space to begin with; the heap is empty until the program calls
+//	Sbrk.  Heap and stack pages get memory, zeroed, the first time
+//	they are touched.
+//
+//	The address space keeps the executable for as long as it needs it,
+//	and lets go of it when it goes away.
+//
+//	Pages holding only code are mapped read-only, and shared with
+//	every other address space running the same executable, through
+//	the text cache.
+//
+//	"executable" is the object code to load into memory; the caller's
+//	reference to it is now ours
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(NoffImage *executable)
 {
-    NoffHeader noffH;
-    unsigned int i, size;
-
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) &&
-        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
-        SwapHeader(&noffH);
+    unsigned int size;
 
-    if (noffH.noffMagic != NOFFMAGIC)
+    profile = NULL;
+    image = executable;
+    if (!image->IsValid())
     {
+        image->Release();
+        image = NULL;
         valid = false;
         return;
     }
+    NoffHeader &noffH = image->noffH;
+    text = textCache->Attach(image);
 
-    // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize; // we need to increase the size
-                                                                                          // to leave room for the stack
+    // how big is address space?  The program, then the heap (empty for
+    // now), then the stack at the very end
+    size = UserAddrSpaceSize;
     numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
-
-    if (numPages > mm->GetFreePageCount())
+    heapStart = divRoundUp(image->GetSize(), PageSize);
+    breakAddr = heapStart * PageSize;
+    stackBottom = numPages - divRoundUp(UserStackSize, PageSize);
+    if (heapStart >= MapAreaBase())  // no room left for the heap
     {
+        textCache->Detach(text);
+        text = NULL;
+        image->Release();
+        image = NULL;
         valid = false;
         return;
     }
 
-    DEBUG('a', "Initializing address space, num pages %d, size %d\n",
-          numPages, size);
-    // first, set up the translation
-    pageTable = new TranslationEntry[numPages];
+#ifndef VM
+    unsigned int i;
+    unsigned int newPages = 0; // code pages already in memory are free
+    unsigned int zeroPages = 0;
     for (i = 0; i < numPages; i++)
+        if (!IsMapped(i))
+            continue;
+        else if (IsZeroPage(i))
+            zeroPages++;
+        else if (!image->IsTextPage(i) || textCache->Lookup(text, i) == -1)
+            newPages++;
+    // the pages holding nothing from the file come first, zeroed
+    newPages += zeroPages;
+    int *frames = new int[newPages];
+    unsigned int nextZero = 0, nextFrame = zeroPages;
+    if (!mm->AllocatePages(newPages, frames, zeroPages))
     {
-        pageTable[i].virtualPage = i; // for now, virtual page # = phys page #
-        pageTable[i].physicalPage = mm->AllocatePage();
-        pageTable[i].valid = TRUE;
-        pageTable[i].use = FALSE;
-        pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE; // if the code segment was entirely on
-                                       // a separate page, we could set its
-                                       // pages to be read-only
-
-        // Zero out each page, to zero the unitialized data segment
-        // and the stack segment
-        unsigned int physicalPageAddress = (pageTable[i].physicalPage) * 128;
-        bzero(&(machine->mainMemory[physicalPageAddress]), 128);
+        delete [] frames;
+        textCache->Detach(text);
+        text = NULL;
+        image->Release();
+        image = NULL;
+        valid = false;
+        return;
     }
+#endif
 
-    // then, copy in the code and data segments into memory
-    if (noffH.code.size > 0)
+    DEBUG('a', "Initializing address space, num pages %d, size %d\n",
+          numPages, size);
+    // first, set up the translation.  With VM, pages get their entries
+    // as the pager brings them in, so the page table starts out empty.
+    pageTable = new PageTable(numPages);
+#ifndef VM
+    for (i = 0; i < numPages; i++)
     {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
-              noffH.code.virtualAddr, noffH.code.size);
-        int counter = 0;
-        while (counter < noffH.code.size)
+        if (!IsMapped(i))       // between the program and the stack
+            continue;
+        PageTableEntry *entry = pageTable->Entry(i);
+        entry->readOnly = image->IsTextPage(i); // code only
+        entry->valid = TRUE;
+        if (entry->readOnly)
         {
-
-            executable->ReadAt(&(machine->mainMemory[Translate(noffH.code.virtualAddr + counter)]),
-                               1, noffH.code.inFileAddr + counter);
-            counter++;
+            // share the code page if it is in memory already, otherwise
+            // read it in, and let the next address space share it
+            int frame = textCache->Lookup(text, i);
+            if (frame != -1)
+                mm->SharePage(frame);
+            else
+            {
+                frame = frames[nextFrame++];
+                image->ReadPage(i, &(machine->mainMemory[frame * PageSize]));
+                textCache->Insert(text, i, frame);
+            }
+            entry->physicalPage = frame;
+            mm->AddMapping(frame, this, i);
+            continue;
         }
-    }
-    if (noffH.initData.size > 0)
-    {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
-              noffH.initData.virtualAddr, noffH.initData.size);
-        int counter = 0;
-        while (counter < noffH.initData.size)
+        if (IsZeroPage(i))
         {
-            executable->ReadAt(&(machine->mainMemory[Translate(noffH.initData.virtualAddr + counter)]),
-                               1, noffH.initData.inFileAddr + counter);
-            counter++;
+            // uninitialized data and stack: already zeroed
+            entry->physicalPage = frames[nextZero++];
+            mm->AddMapping(entry->physicalPage, this, i);
+            continue;
         }
+        entry->physicalPage = frames[nextFrame++];
+        mm->AddMapping(entry->physicalPage, this, i);
+
+        // then, fill in the page: the code and data that fall in it,
+        // zeroes for the unitialized data segment and the stack
+        image->ReadPage(i, &(machine->mainMemory[entry->physicalPage *
+                                                 PageSize]));
     }
+    while (nextFrame < newPages)        // code pages someone else read in
+        mm->DeallocatePage(frames[nextFrame++]);
+    delete [] frames;
+#endif
 
     valid = true;
+    attached = NULL;
+    created = NULL;
+    mapped = NULL;
+    mapAreaMap = new BitMap(MapAreaSize / PageSize);
+#ifdef USE_TLB
+    asid = asidMap->Find();
+    ASSERT(asid != -1);
+#endif
     printf(
         "Loaded Program: %d code | %d data | %d bss\n",
         noffH.code.size, noffH.initData.size, noffH.uninitData.size
@@ -156,6 +196,19 @@ unsigned int AddrSpace::GetNumPages()
 // AddrSpace::AddrSpace
 // 	Create an address space as a copy of an existing one
 //
+//  Nothing is copied yet: the copy shares every physical page of the
+//  source, and both map the writable ones read-only.  The first write
+//  to such a page, by either address space, traps with a
+//  ReadOnlyException, and CopyOnWrite then gives the writer its own
+//  copy of just that page.  (Shared segments stay attached to both,
+//  and writable.  Mapped files aren't inherited: the copy starts out
+//  without them.)  So forking costs no memory, and no more
+//  time than copying the page table, however big the process.
+//
+//  With VM, pages that are only in the source's swap slots need slots
+//  of their own; if the swap file runs out, the copy is given back
+//  and the address space is invalid.
+//
 //  "space" is the address space we are copying
 //----------------------------------------------------------------------
 
@@ -163,40 +216,133 @@ AddrSpace::AddrSpace(AddrSpace &space)
 {
 
     valid = true;
+    profile = space.profile;    // same program, same profile
+    image = space.image;        // and the same executable behind it
+    if (image != NULL)
+        image->Hold();
+    text = space.text;          // whose code we share too
+    if (text != NULL)
+        textCache->Hold(text);
 
     // 1. Find how big the source address space is
     unsigned int n = space.GetNumPages();
 
-    // 2. Check if there is enough free memory to make the copy. If not, then
-    //    invalidate the address space.
-    if (n > mm->GetFreePageCount())
+    // 2. Create a new pagetable of same size as source addr space,
+    //    with the same heap and stack
+    pageTable = new PageTable(n);
+    numPages = n;
+    heapStart = space.heapStart;
+    breakAddr = space.breakAddr;
+    stackBottom = space.stackBottom;
+
+    // and the same shared segments attached, at the same addresses
+    // (but the ones the source created stay its own to let go of)
+    attached = NULL;
+    created = NULL;
+    mapped = NULL;
+    mapAreaMap = new BitMap(MapAreaSize / PageSize);
+    for (AttachedSegment *a = space.attached; a != NULL; a = a->next)
     {
-        valid = false;
-        return;
-    }
+        AttachedSegment *copy = new AttachedSegment;
 
-    // 3. Create a new pagetable of same size as source addr space
-    pageTable = new TranslationEntry[n];
-    numPages = n;
+        copy->segment = a->segment;
+        copy->firstPage = a->firstPage;
+        copy->next = attached;
+        attached = copy;
+        segmentTable->Hold(a->segment);
+        for (unsigned int i = 0; i < a->segment->numPages; i++)
+            mapAreaMap->Mark(a->firstPage - MapAreaBase() + i);
+    }
 
-    // 4. Make a copy of the PTEs but allocate new physical pages
-    TranslationEntry *ppt = space.pageTable;
-    for (unsigned int i = 0; i < numPages; i++)
+    // 3. Make a copy of the PTEs, sharing the physical pages; from now
+    //    on neither address space may write to them directly.  Pages
+    //    the source hasn't brought in yet stay out in the copy too.
+    //    The source's TLB entries go first, so their use and dirty
+    //    bits are in its page table when we copy it, and so that the
+    //    TLB can't let it write to the shared pages.
+#ifdef USE_TLB
+    machine->FlushTLB(space.asid);
+#endif
+    machine->FlushSoftTLB();
+    bool copied = TRUE;
+    for (unsigned int i = 0; i < numPages && copied; i++)
     {
-        pageTable[i].virtualPage = ppt[i].virtualPage;
-        pageTable[i].physicalPage = mm->AllocatePage();
-        pageTable[i].valid = ppt[i].valid;
-        pageTable[i].use = ppt[i].use;
-        pageTable[i].dirty = ppt[i].dirty;
-        pageTable[i].readOnly = ppt[i].readOnly;
-
-        // 5. For each page, make an actual copy of the contents of the page
-        //    Multiply the physicalPage number by PageSize to get the actual
-        //    byte address
-        bcopy(&(machine->mainMemory[ppt[i].physicalPage * PageSize]),
-              &(machine->mainMemory[pageTable[i].physicalPage * PageSize]),
-              PageSize);
+        PageTableEntry *source = space.pageTable->Lookup(i);
+        if (source == NULL || space.IsFilePage(i))
+            continue;
+        PageTableEntry *entry = pageTable->Entry(i);
+        *entry = *source;
+        if (source->valid)
+        {
+            mm->SharePage(source->physicalPage);
+            mm->AddMapping(source->physicalPage, this, i);
+        }
+        // shared segments stay shared, and writable
+        if (source->valid && !source->readOnly && !IsSharedPage(i))
+        {
+            space.SetCopyOnWrite(i);
+            SetCopyOnWrite(i);
+        }
+        entry->swapSlot = -1;
+#ifdef VM
+        // A page in memory is ours to save if it is taken back, so it
+        // counts as dirty; a page that is only in the source's swap
+        // slot gets a slot of its own.
+        if (source->valid)
+            entry->dirty = TRUE;
+        else if (source->swapSlot != -1)
+        {
+            entry->swapSlot = pager->CopySwap(source->swapSlot);
+            copied = (entry->swapSlot != -1);
+        }
+#endif
     }
+#ifdef USE_TLB
+    asid = asidMap->Find();
+    ASSERT(asid != -1);
+#endif
+    if (!copied)        // out of swap: undo the pages we did copy
+    {
+        Release();
+        valid = false;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create an address space from a page table restored from a
+//	checkpoint.  The physical pages it maps must already be claimed
+//	from the memory manager, and hold the contents the process had.
+//
+//  "table" is the page table, which the address space now owns
+//  "executable" is the program's image, to read in the pages that
+//	aren't in memory; NULL if there are none
+//  "heapStartPage", "breakAt" and "stackBottomPage" are where the
+//	heap and stack were
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(PageTable *table, NoffImage *executable,
+                     unsigned int heapStartPage, unsigned int breakAt,
+                     unsigned int stackBottomPage)
+{
+    valid = true;
+    profile = NULL;
+    image = executable;
+    text = NULL;                // its code pages stay private
+    pcb = NULL;
+    pageTable = table;
+    numPages = table->GetNumPages();
+    heapStart = heapStartPage;
+    breakAddr = breakAt;
+    stackBottom = stackBottomPage;
+    attached = NULL;            // checkpoints don't have any
+    created = NULL;
+    mapped = NULL;
+    mapAreaMap = new BitMap(MapAreaSize / PageSize);
+#ifdef USE_TLB
+    asid = asidMap->Find();
+    ASSERT(asid != -1);
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -205,16 +351,67 @@ AddrSpace::AddrSpace(AddrSpace &space)
 //
 //  Deallocating the address space involves remove the physical frames
 //  using the MemoryManager, deleting the process control block using
-//  the PCBManager.
+//  the PCBManager.  Mapped files are written back first.  With a TLB,
+//  our entries are flushed before our ASID is handed back, so the next
+//  owner of the ASID can't see them (and before the page table they
+//  point to goes).
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-    if (!valid)
-        return;
+    if (valid)
+        Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Release
+// 	Give back everything a complete address space holds: its pages,
+//	swap slots, page table, shared segments, mapped files, and code.
+//	Also used to undo a copy that could not be finished.
+//----------------------------------------------------------------------
+
+void AddrSpace::Release()
+{
+    while (mapped != NULL)
+        UnmapFile(mapped->firstPage * PageSize);
+#ifdef USE_TLB
+    machine->FlushTLB(asid);
+    asidMap->Clear(asid);
+#endif
     for (unsigned int i = 0; i < numPages; i++)
-        mm->DeallocatePage(pageTable[i].physicalPage);
+    {
+        PageTableEntry *entry = pageTable->Lookup(i);
+        if (entry == NULL)
+            continue;
+        if (entry->valid)
+            mm->DeallocatePage(entry->physicalPage, this, i);
+#ifdef VM
+        if (entry->swapSlot != -1)
+            pager->GetSwap()->Free(entry->swapSlot);
+#endif
+    }
     delete pageTable;
+    while (attached != NULL)
+    {
+        AttachedSegment *a = attached;
+
+        attached = a->next;
+        segmentTable->Detach(a->segment);
+        delete a;
+    }
+    while (created != NULL)
+    {
+        AttachedSegment *c = created;
+
+        created = c->next;
+        segmentTable->Detach(c->segment);
+        delete c;
+    }
+    delete mapAreaMap;
+    if (text != NULL)
+        textCache->Detach(text);
+    if (image != NULL)
+        image->Release();
 }
 
 //----------------------------------------------------------------------
@@ -265,21 +462,802 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	drop the machine's cached translations for the old one.  With a
+//	TLB, just switch the machine to our ASID: the TLB entries of other
+//	address spaces can stay, since they won't match ours.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState()
 {
-    machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
+    if (profiler != NULL)
+        profiler->SetImage(profile);
+#ifdef USE_TLB
+    machine->SetASID(asid);
+#else
+    machine->twoLevelTable = pageTable;
+    machine->FlushSoftTLB();
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+// 	Handle a PageFaultException on "virtualAddr", so that the faulting
+//	instruction can be retried.  A page that isn't in memory yet is
+//	brought in (see FaultIn).  With a TLB, the translation for the
+//	page is then copied from our page table into the TLB.
+//
+//	Returns FALSE if the address isn't in this address space (a
+//	genuine addressing error), or the page can't be brought in.
+//----------------------------------------------------------------------
+
+bool AddrSpace::HandlePageFault(int virtualAddr)
+{
+    unsigned int vpn = (unsigned)virtualAddr / PageSize;
+
+    if (vpn >= numPages)
+        return FALSE;
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+    if (entry == NULL || !entry->valid)
+    {
+        if (!FaultIn(vpn))
+            return FALSE;
+        entry = pageTable->Lookup(vpn);
+    }
+#ifdef USE_TLB
+    DEBUG('a', "TLB miss at 0x%x, refilling vpn %d\n", virtualAddr, vpn);
+    machine->LoadTLB(entry);
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FaultIn
+// 	Bring page "vpn", which isn't in memory, into memory.  With
+//	virtual memory, the pager does it.  Otherwise the program itself
+//	is all in memory already, so the page is part of a mapped file,
+//	read in from the file, or heap or stack, touched for the first
+//	time, which gets a zeroed page.  A page just below the stack
+//	grows the stack.
+//
+//	Returns FALSE if the page isn't in the address space, or there is
+//	no memory for it.
+//----------------------------------------------------------------------
+
+bool AddrSpace::FaultIn(unsigned int vpn)
+{
+    if (!IsMapped(vpn) && !GrowStack(vpn))
+        return FALSE;
+#ifdef VM
+    return pager->PageIn(this, vpn);
+#else
+    if (mm->GetFreePageCount() == 0)
+        return FALSE;
+    if (IsFilePage(vpn))
+    {
+        int frame = mm->AllocatePage();
+
+        ReadFilePage(vpn, &(machine->mainMemory[frame * PageSize]));
+        MapPage(vpn, frame);
+        return TRUE;
+    }
+    ASSERT(IsZeroPage(vpn));
+    MapPage(vpn, mm->AllocatePage(TRUE));
+    return TRUE;
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsMapped
+// 	Return TRUE if page "vpn" is part of the address space: the
+//	program, the heap up to the break, a mapped file, or the stack.
+//	(Shared segment pages are always in memory.)
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsMapped(unsigned int vpn)
+{
+    return vpn < divRoundUp(breakAddr, PageSize) ||
+           (vpn >= stackBottom && vpn < numPages) || IsFilePage(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsZeroPage
+// 	Return TRUE if page "vpn" holds nothing from the executable when
+//	the program starts, so that it starts out all zeroes: heap, stack,
+//	and pages of the program with only uninitialized data.  Pages of
+//	mapped files are read from the file.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsZeroPage(unsigned int vpn)
+{
+    if (IsFilePage(vpn))
+        return FALSE;
+    return vpn >= heapStart || (image != NULL && image->IsZeroPage(vpn));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GrowStack
+// 	A page below the stack was touched: grow the stack down to it,
+//	unless that would make the stack bigger than MaxStackSize, or
+//	leave no page between it and the heap.
+//
+//	Returns TRUE if the stack now includes page "vpn".
+//----------------------------------------------------------------------
+
+bool AddrSpace::GrowStack(unsigned int vpn)
+{
+    if (vpn >= stackBottom || numPages - vpn > MaxStackSize / PageSize ||
+        vpn <= divRoundUp(breakAddr, PageSize))
+        return FALSE;
+    DEBUG('a', "Growing the stack down to vpn %d\n", vpn);
+    stackBottom = vpn;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+// 	Move the end of the heap by "increment" bytes: grow the heap, or
+//	shrink it if "increment" is negative.  New heap pages are only
+//	given memory when they are first touched, zeroed; pages wholly
+//	past the new end are given back at once.  The heap must leave at
+//	least one page between it and the room for shared segments and
+//	mapped files.
+//
+//	Returns the old end of the heap -- where the new memory starts --
+//	or -1 if the heap can't be moved that far.
+//----------------------------------------------------------------------
+
+int AddrSpace::Sbrk(int increment)
+{
+    int oldBreak = breakAddr;
+    int newBreak = oldBreak + increment;
+
+    if (newBreak < (int) (heapStart * PageSize) ||
+        (unsigned) divRoundUp(newBreak, PageSize) >= MapAreaBase())
+        return -1;
+    for (unsigned int vpn = divRoundUp(newBreak, PageSize);
+         vpn < (unsigned) divRoundUp(oldBreak, PageSize); vpn++)
+        DropPage(vpn);
+    breakAddr = newBreak;
+    DEBUG('a', "Break moved from 0x%x to 0x%x\n", oldBreak, newBreak);
+    return oldBreak;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapAreaBase
+// 	Return the first page of the room for shared segments and mapped
+//	files, which ends where the stack may grow down to.
+//----------------------------------------------------------------------
+
+unsigned int AddrSpace::MapAreaBase()
+{
+    return numPages - MaxStackSize / PageSize - MapAreaSize / PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindRoom
+// 	Set aside "n" pages in a row of the room for shared segments and
+//	mapped files, at the first place they fit.
+//
+//	Returns the first of the pages, or -1 if there is no room.
+//----------------------------------------------------------------------
+
+int AddrSpace::FindRoom(unsigned int n)
+{
+    unsigned int room = MapAreaSize / PageSize;
+    unsigned int first, i;
+
+    for (first = 0; first + n <= room; first += i + 1)
+    {
+        for (i = 0; i < n; i++)
+            if (mapAreaMap->Test(first + i))
+                break;
+        if (i == n)
+            break;
+    }
+    if (first + n > room)
+        return -1;
+    for (i = 0; i < n; i++)
+        mapAreaMap->Mark(first + i);
+    return MapAreaBase() + first;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeRoom
+// 	The "n" pages from "first" on, set aside by FindRoom, are no
+//	longer in use.
+//----------------------------------------------------------------------
+
+void AddrSpace::FreeRoom(unsigned int first, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++)
+        mapAreaMap->Clear(first - MapAreaBase() + i);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsSharedPage
+// 	Return TRUE if page "vpn" is part of a shared segment we have
+//	attached.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsSharedPage(unsigned int vpn)
+{
+    for (AttachedSegment *a = attached; a != NULL; a = a->next)
+        if (vpn >= a->firstPage && vpn < a->firstPage + a->segment->numPages)
+            return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AttachSegment
+// 	Map every page of the shared segment "segment" into the room for
+//	shared segments, at the first place it fits.  The pages are
+//	writable, and are never copied on write, so what one address space
+//	stores there, every other one attaching the segment sees.  The
+//	caller has already counted us as a user of the segment.
+//
+//	Returns the virtual address the segment starts at, or -1 if there
+//	is no room for it.
+//----------------------------------------------------------------------
+
+int AddrSpace::AttachSegment(SharedSegment *segment)
+{
+    int first = FindRoom(segment->numPages);
+
+    if (first == -1)
+        return -1;
+    for (unsigned int n = 0; n < segment->numPages; n++)
+    {
+        mm->SharePage(segment->frames[n]);
+        MapPage(first + n, segment->frames[n]);
+    }
+    AttachedSegment *a = new AttachedSegment;
+    a->segment = segment;
+    a->firstPage = first;
+    a->next = attached;
+    attached = a;
+    DEBUG('a', "Attached shared segment %s at vpn %d\n", segment->name,
+          a->firstPage);
+    return a->firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::DetachSegment
+// 	Unmap the shared segment attached at "virtualAddr", and let go of
+//	it; the last address space to let go frees it.
+//
+//	Returns FALSE if no segment is attached there.
+//----------------------------------------------------------------------
+
+bool AddrSpace::DetachSegment(int virtualAddr)
+{
+    AttachedSegment **prev = &attached;
+
+    while (*prev != NULL &&
+           (int) ((*prev)->firstPage * PageSize) != virtualAddr)
+        prev = &(*prev)->next;
+    if (*prev == NULL)
+        return FALSE;
+
+    AttachedSegment *a = *prev;
+    *prev = a->next;
+    for (unsigned int n = 0; n < a->segment->numPages; n++)
+        DropPage(a->firstPage + n);
+    FreeRoom(a->firstPage, a->segment->numPages);
+    DEBUG('a', "Detached shared segment %s\n", a->segment->name);
+    segmentTable->Detach(a->segment);
+    delete a;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HoldSegment
+// 	We have just created the shared segment "segment", and are its
+//	first user: remember to let go of it when we go, even if we never
+//	attach it.
+//----------------------------------------------------------------------
+
+void AddrSpace::HoldSegment(SharedSegment *segment)
+{
+    AttachedSegment *c = new AttachedSegment;
+
+    c->segment = segment;
+    c->firstPage = 0;           // not mapped
+    c->next = created;
+    created = c;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapFile
+// 	Map the whole of the open file "vnode" into the room for mapped
+//	files, at the first place it fits.  No page is read in yet: each
+//	is read from the file the first time it is touched, and written
+//	back to it, if it was written to, when it is unmapped or (with
+//	virtual memory) taken back by the pager.  The bytes past the end
+//	of the file in its last page start out zero, and are never
+//	written back, so the file keeps its length.  The file stays open
+//	while it is mapped, even if the program closes it.
+//
+//	Returns the virtual address the file starts at, or -1 if it is
+//	empty or there is no room for it.
+//----------------------------------------------------------------------
+
+int AddrSpace::MapFile(VNode *vnode)
+{
+    int length = vnode->Length();
+
+    if (length <= 0)
+        return -1;
+    unsigned int n = divRoundUp(length, PageSize);
+    int first = FindRoom(n);
+    if (first == -1)
+        return -1;
+
+    vnode->IncreaseRef();
+    MappedFile *m = new MappedFile;
+    m->vnode = vnode;
+    m->length = length;
+    m->firstPage = first;
+    m->numPages = n;
+    m->next = mapped;
+    mapped = m;
+    DEBUG('a', "Mapped file %s at vpn %d, %d pages\n",
+          vnode->GetFileName(), first, n);
+    return first * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapFile
+// 	Unmap the file mapped at "virtualAddr": write the pages we wrote
+//	to back to the file, give back their memory, and let go of the
+//	file.
+//
+//	Returns FALSE if no file is mapped there.
+//----------------------------------------------------------------------
+
+bool AddrSpace::UnmapFile(int virtualAddr)
+{
+    MappedFile **prev = &mapped;
+
+    while (*prev != NULL &&
+           (int) ((*prev)->firstPage * PageSize) != virtualAddr)
+        prev = &(*prev)->next;
+    if (*prev == NULL)
+        return FALSE;
+
+    MappedFile *m = *prev;
+    machine->SyncTLB();         // the page table gets the TLB's dirty bits
+    for (unsigned int n = 0; n < m->numPages; n++)
+    {
+        unsigned int vpn = m->firstPage + n;
+        PageTableEntry *entry = pageTable->Lookup(vpn);
+
+        if (entry != NULL && entry->valid && entry->dirty)
+            WriteFilePage(vpn, &(machine->mainMemory[entry->physicalPage *
+                                                     PageSize]));
+        DropPage(vpn);
+    }
+    *prev = m->next;
+    FreeRoom(m->firstPage, m->numPages);
+    DEBUG('a', "Unmapped file %s\n", m->vnode->GetFileName());
+    vnm->RelieveVNode(m->vnode);
+    delete m;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindFile
+// 	Return the mapped file page "vpn" is part of, NULL if none.
+//----------------------------------------------------------------------
+
+MappedFile *AddrSpace::FindFile(unsigned int vpn)
+{
+    for (MappedFile *m = mapped; m != NULL; m = m->next)
+        if (vpn >= m->firstPage && vpn < m->firstPage + m->numPages)
+            return m;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsFilePage
+// 	Return TRUE if page "vpn" is part of a file we have mapped.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsFilePage(unsigned int vpn)
+{
+    return FindFile(vpn) != NULL;
 }
 
-// perform MMU translation to access physical memory
-unsigned int AddrSpace::Translate(unsigned int virtualAddr)
+//----------------------------------------------------------------------
+// AddrSpace::ReadFilePage
+// 	Fill in "into" with mapped file page "vpn": the part of the file
+//	it holds, then zeroes past the end of the file.
+//----------------------------------------------------------------------
+
+void AddrSpace::ReadFilePage(unsigned int vpn, char *into)
+{
+    MappedFile *m = FindFile(vpn);
+
+    ASSERT(m != NULL);
+    int offset = (vpn - m->firstPage) * PageSize;
+    int n = min(m->length - offset, PageSize);
+
+    DEBUG('a', "Reading vpn %d from %s at %d\n", vpn,
+          m->vnode->GetFileName(), offset);
+    n = max(m->vnode->ReadInto(into, n, offset), 0);
+    bzero(into + n, PageSize - n);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteFilePage
+// 	Write mapped file page "vpn", from "from", back to its file, up
+//	to the end of the file.
+//----------------------------------------------------------------------
+
+void AddrSpace::WriteFilePage(unsigned int vpn, char *from)
+{
+    MappedFile *m = FindFile(vpn);
+
+    ASSERT(m != NULL);
+    int offset = (vpn - m->firstPage) * PageSize;
+
+    DEBUG('a', "Writing vpn %d back to %s at %d\n", vpn,
+          m->vnode->GetFileName(), offset);
+    m->vnode->WriteFrom(from, min(m->length - offset, PageSize), offset);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::DropPage
+// 	Page "vpn" is no longer part of the address space: give back its
+//	physical page and its swap slot, if it has them.  Touching it
+//	again is an addressing error, unless the heap grows back over it,
+//	when it starts afresh, zeroed.
+//----------------------------------------------------------------------
+
+void AddrSpace::DropPage(unsigned int vpn)
+{
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+
+    if (entry == NULL)
+        return;
+    if (entry->valid)
+    {
+        entry->valid = FALSE;
+        machine->FlushSoftTLB();
+#ifdef USE_TLB
+        machine->FlushTLBPage(asid, vpn);
+#endif
+        mm->DeallocatePage(entry->physicalPage, this, vpn);
+    }
+#ifdef VM
+    if (entry->swapSlot != -1)
+    {
+        pager->GetSwap()->Free(entry->swapSlot);
+        entry->swapSlot = -1;
+    }
+#endif
+    entry->copyOnWrite = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapPage
+// 	Map virtual page "vpn" to physical page "frame", which has just
+//	been filled in for it.  Pages holding only code are mapped
+//	read-only.
+//----------------------------------------------------------------------
+
+void AddrSpace::MapPage(unsigned int vpn, int frame)
+{
+    PageTableEntry *entry = pageTable->Entry(vpn);
+
+    DEBUG('a', "Mapping vpn %d to page %d\n", vpn, frame);
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->readOnly = (image != NULL && image->IsTextPage(vpn));
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    mm->AddMapping(frame, this, vpn);
+    machine->FlushSoftTLB();
+}
+
+#ifdef VM
+//----------------------------------------------------------------------
+// AddrSpace::UnmapPage
+// 	Take virtual page "vpn" out of memory and give its physical page
+//	back.  The pager has already saved the contents, if they can't be
+//	read in again from where they came from; the next touch brings
+//	the page back, into a page of our own, so it is no longer
+//	copy-on-write.
+//----------------------------------------------------------------------
+
+void AddrSpace::UnmapPage(unsigned int vpn)
+{
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+
+    DEBUG('a', "Unmapping vpn %d from page %d\n", vpn,
+          entry->physicalPage);
+    entry->valid = FALSE;
+    entry->copyOnWrite = FALSE;
+    machine->FlushSoftTLB();
+#ifdef USE_TLB
+    machine->FlushTLBPage(asid, vpn);
+#endif
+    mm->DeallocatePage(entry->physicalPage, this, vpn);
+}
+
+#endif // VM
+
+//----------------------------------------------------------------------
+// AddrSpace::GetSwapSlot, AddrSpace::SetSwapSlot
+// 	Return, or set, where page "vpn" is saved in the swap file; -1 if
+//	it isn't.
+//----------------------------------------------------------------------
+
+int AddrSpace::GetSwapSlot(unsigned int vpn)
+{
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+
+    return (entry == NULL) ? -1 : entry->swapSlot;
+}
+
+void AddrSpace::SetSwapSlot(unsigned int vpn, int slot)
+{
+    pageTable->Entry(vpn)->swapSlot = slot;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetCopyOnWrite
+// 	Mark page "vpn" as shared copy-on-write: map it read-only, and
+//	remember that writes to it are allowed once it is copied.
+//
+//	The caller must drop the machine's cached translations.
+//----------------------------------------------------------------------
+
+void AddrSpace::SetCopyOnWrite(unsigned int vpn)
 {
-    unsigned int pageNumber = virtualAddr / PageSize;
-    unsigned int pageOffset = virtualAddr % PageSize;
-    unsigned int frameNumber = pageTable[pageNumber].physicalPage;
-    int physicalAddr = frameNumber * PageSize + pageOffset;
-    return physicalAddr;
-}
\ No newline at end of file
+    PageTableEntry *entry = pageTable->Entry(vpn);
+
+    entry->copyOnWrite = TRUE;
+    entry->readOnly = TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsCopyOnWrite
+// 	Return TRUE if page "vpn" is shared copy-on-write.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsCopyOnWrite(unsigned int vpn)
+{
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+
+    return entry != NULL && entry->copyOnWrite;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a ReadOnlyException on "virtualAddr": if its page is shared
+//	copy-on-write, copy it to a page of our own and make that
+//	writable, so that the faulting instruction can be retried.  If
+//	no other address space maps the page any more, it is already ours,
+//	and is just made writable.
+//
+//	Returns FALSE if the page is really read-only, or there is no
+//	memory left to copy it to.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOnWrite(int virtualAddr)
+{
+    unsigned int vpn = (unsigned)virtualAddr / PageSize;
+
+    if (vpn >= numPages || !IsCopyOnWrite(vpn))
+        return FALSE;
+    stats->numCOWFaults++;
+
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+    int oldPage = entry->physicalPage;
+    if (mm->GetRefCount(oldPage) > 1)
+    {
+#ifdef VM
+        int newPage = pager->AllocateFrame();
+        if (newPage == -1)
+            return FALSE;
+#else
+        if (mm->GetFreePageCount() == 0)
+            return FALSE;
+        int newPage = mm->AllocatePage();
+#endif
+        bcopy(&(machine->mainMemory[oldPage * PageSize]),
+              &(machine->mainMemory[newPage * PageSize]), PageSize);
+        mm->DeallocatePage(oldPage, this, vpn);
+        entry->physicalPage = newPage;
+        mm->AddMapping(newPage, this, vpn);
+        stats->numCOWCopies++;
+    }
+    DEBUG('a', "Copy-on-write fault at 0x%x, vpn %d now in page %d\n",
+          virtualAddr, vpn, entry->physicalPage);
+    entry->copyOnWrite = FALSE;
+    entry->readOnly = FALSE;
+
+    machine->FlushSoftTLB();
+#ifdef USE_TLB
+    machine->FlushTLBPage(asid, vpn);
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UserPage
+// 	Return the physical page holding virtual page "vpn", for the
+//	kernel to read (or, if "writing", to write) directly: bring it in
+//	if it isn't in memory, copy it first if it is shared copy-on-write,
+//	and set its use (and dirty) bits as the machine would.
+//
+//	Returns -1 if the page isn't in the address space, can't be
+//	brought in, or is read-only and "writing".
+//----------------------------------------------------------------------
+
+int AddrSpace::UserPage(unsigned int vpn, bool writing)
+{
+    if (vpn >= numPages)
+        return -1;
+    PageTableEntry *entry = pageTable->Lookup(vpn);
+    if (entry == NULL || !entry->valid)
+    {
+        if (!FaultIn(vpn))
+            return -1;
+        entry = pageTable->Lookup(vpn);
+    }
+    if (writing && entry->readOnly && !CopyOnWrite(vpn * PageSize))
+        return -1;
+    entry->use = TRUE;
+    if (writing)
+    {
+        entry->dirty = TRUE;
+        machine->InvalidateDecodedPage(entry->physicalPage);
+    }
+    return entry->physicalPage;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Translate
+// 	Return the physical address of "virtualAddr", for the kernel to
+//	access directly; "writing" if the kernel is about to store through
+//	the result.  The address must be good.
+//----------------------------------------------------------------------
+
+unsigned int AddrSpace::Translate(unsigned int virtualAddr, bool writing)
+{
+    int frame = UserPage(virtualAddr / PageSize, writing);
+
+    ASSERT(frame != -1);
+    return frame * PageSize + virtualAddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn
+// 	Copy "nBytes" from user memory at "virtualAddr" into the kernel
+//	buffer "into".  Each page is translated once, and the part of the
+//	buffer in it copied in one go.
+//
+//	Returns "nBytes", or -1 if part of the buffer isn't in the address
+//	space or can't be brought in.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyIn(unsigned int virtualAddr, char *into, int nBytes)
+{
+    int done = 0;
+
+    while (done < nBytes)
+    {
+        unsigned int offset = virtualAddr % PageSize;
+        int n = min(nBytes - done, (int) (PageSize - offset));
+        int frame = UserPage(virtualAddr / PageSize, FALSE);
+
+        if (frame == -1)
+            return -1;
+        bcopy(&(machine->mainMemory[frame * PageSize + offset]),
+              into + done, n);
+        done += n;
+        virtualAddr += n;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOut
+// 	Copy "nBytes" from the kernel buffer "from" into user memory at
+//	"virtualAddr", a page at a time, as for CopyIn.
+//
+//	Returns "nBytes", or -1 if part of the buffer isn't in the address
+//	space, can't be brought in, or is read-only; what comes before it
+//	is copied all the same.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyOut(char *from, unsigned int virtualAddr, int nBytes)
+{
+    int done = 0;
+
+    while (done < nBytes)
+    {
+        unsigned int offset = virtualAddr % PageSize;
+        int n = min(nBytes - done, (int) (PageSize - offset));
+        int frame = UserPage(virtualAddr / PageSize, TRUE);
+
+        if (frame == -1)
+            return -1;
+        bcopy(from + done,
+              &(machine->mainMemory[frame * PageSize + offset]), n);
+        done += n;
+        virtualAddr += n;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PinUser
+// 	Return where "virtualAddr" is in the machine's memory, so that the
+//	kernel can do I/O straight to (if "writing") or from the rest of
+//	its page, and pin the page, so that it stays there even if the I/O
+//	waits for the disk and the pager runs meanwhile.  UnpinUser lets
+//	it go again.
+//
+//	Returns NULL if the address isn't in the address space, can't be
+//	brought in, or is read-only and "writing".
+//----------------------------------------------------------------------
+
+char *AddrSpace::PinUser(unsigned int virtualAddr, bool writing)
+{
+    int frame = UserPage(virtualAddr / PageSize, writing);
+
+    if (frame == -1)
+        return NULL;
+    mm->PinPage(frame);
+    return &(machine->mainMemory[frame * PageSize + virtualAddr % PageSize]);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnpinUser
+// 	The I/O to or from "hostAddr", returned by PinUser, is done: the
+//	page may be taken back again.
+//----------------------------------------------------------------------
+
+void AddrSpace::UnpinUser(char *hostAddr)
+{
+    mm->UnpinPage((hostAddr - machine->mainMemory) / PageSize);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+// 	Copy the string at "virtualAddr" in user memory, and its '\0',
+//	into the kernel buffer "into", of "size" bytes.  Each page is
+//	searched for the end of the string and copied in one go.
+//
+//	Returns the length of the string, or -1 if it doesn't fit, or
+//	runs into an address that isn't in the address space.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyInString(unsigned int virtualAddr, char *into, int size)
+{
+    int done = 0;
+
+    while (done < size)
+    {
+        unsigned int offset = virtualAddr % PageSize;
+        int n = min(size - done, (int) (PageSize - offset));
+        int frame = UserPage(virtualAddr / PageSize, FALSE);
+
+        if (frame == -1)
+            return -1;
+        char *from = &(machine->mainMemory[frame * PageSize + offset]);
+        char *end = (char *) memchr(from, '\0', n);
+        if (end != NULL)
+        {
+            bcopy(from, into + done, end - from + 1);
+            return done + (end - from);
+        }
+        bcopy(from, into + done, n);
+        done += n;
+        virtualAddr += n;
+    }
+    return -1;
+}
@@ -6,6 +6,21 @@
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
+//	Every address space is UserAddrSpaceSize bytes of virtual memory,
+//	laid out as:
+//
+//		code, initialized data, uninitialized data (from the file)
+//		heap, growing up to the break (see Sbrk)
+//		at least one page no one may touch
+//		room to attach shared segments (see sharedmem.h) and
+//		map files (see Mmap)
+//		stack, growing down from the end of the address space
+//
+//	Only the pages in use get page table entries and memory: heap
+//	and stack pages are zero-filled the first time they are touched.
+//	The stack grows whenever a page just below it is touched, up to
+//	MaxStackSize.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -16,16 +31,54 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "pcb.h"
+#include "profile.h"
+#include "noffimage.h"
+#include "textcache.h"
+#include "sharedmem.h"
+#include "vnode.h"
+#include "bitmap.h"
+
+#define UserStackSize		1024 	// stack to start with
+#define MaxStackSize		(32 * 1024)	// most it may grow to
+#define MapAreaSize		(64 * 1024)	// room for shared segments and
+						// mapped files, just below
+						// the stack
+#define UserAddrSpaceSize	(256 * 1024)	// the whole virtual address
+						// space, a multiple of PageSize
+
+// A shared segment attached to an address space, and where.
+
+class AttachedSegment {
+  public:
+    SharedSegment *segment;
+    unsigned int firstPage;		// the virtual page it starts at
+    AttachedSegment *next;		// the next one attached
+};
+
+// A file mapped into an address space, and where.
 
-#define UserStackSize		1024 	// increase this as necessary!
+class MappedFile {
+  public:
+    VNode *vnode;			// the file, held open while mapped
+    int length;				// # of bytes mapped: the whole file,
+					// as long as it was when mapped
+    unsigned int firstPage;		// the virtual page it starts at
+    unsigned int numPages;
+    MappedFile *next;			// the next one mapped
+};
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
+    AddrSpace(NoffImage *executable);	// Create an address space,
 					// initializing it with the program
-					// stored in the file "executable"
+					// "executable"
     AddrSpace(AddrSpace& space); // Create an address space,
           // which is a copy of an existing one
+    AddrSpace(PageTable *table, NoffImage *executable,
+              unsigned int heapStartPage, unsigned int breakAt,
+              unsigned int stackBottomPage);
+					// Create an address space from a
+					// restored page table and layout
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -35,15 +88,112 @@ class AddrSpace {
     void RestoreState();		// info on a context switch
     bool IsValid();
     unsigned int GetNumPages(); // get size of addr space
-    unsigned int Translate(unsigned int virtualAddr);
+    PageTable *GetPageTable() { return pageTable; }
+    unsigned int Translate(unsigned int virtualAddr, bool writing = FALSE);
+    int CopyIn(unsigned int virtualAddr, char *into, int nBytes);
+    int CopyOut(char *from, unsigned int virtualAddr, int nBytes);
+					// Copy "nBytes" between user memory
+					// and the kernel; return how many,
+					// -1 if an address is bad
+    int CopyInString(unsigned int virtualAddr, char *into, int size);
+					// Copy in a string of less than
+					// "size" bytes; return its length,
+					// -1 if too long or bad
+    char *PinUser(unsigned int virtualAddr, bool writing);
+    void UnpinUser(char *hostAddr);	// Where "virtualAddr" is in host
+					// memory, its page held there for
+					// I/O straight to or from it
+    bool HandlePageFault(int virtualAddr);
+					// Make "virtualAddr" addressable:
+					// page it in, and load the TLB
+    int Sbrk(int increment);		// Move the break; return the old
+					// one, -1 if there isn't room
+    unsigned int GetHeapStart() { return heapStart; }
+    unsigned int GetBreak() { return breakAddr; }
+    unsigned int GetStackBottom() { return stackBottom; }
+    bool IsZeroPage(unsigned int vpn);	// Does page "vpn" start out all
+					// zeroes?
+    int AttachSegment(SharedSegment *segment);
+					// Map "segment"; return its address,
+					// -1 if there isn't room
+    bool DetachSegment(int virtualAddr);
+					// Unmap the segment at "virtualAddr"
+    void HoldSegment(SharedSegment *segment);
+					// We created "segment": keep it
+					// until we go
+    int MapFile(VNode *vnode);		// Map the file "vnode"; return its
+					// address, -1 if there isn't room
+    bool UnmapFile(int virtualAddr);	// Write back and unmap the file
+					// mapped at "virtualAddr"
+    bool IsFilePage(unsigned int vpn);	// Is page "vpn" in a mapped file?
+    void ReadFilePage(unsigned int vpn, char *into);
+    void WriteFilePage(unsigned int vpn, char *from);
+					// Read, or write back, the part of
+					// a mapped file page "vpn" holds
+    bool HasMappings()
+	{ return attached != NULL || created != NULL || mapped != NULL; }
+    void MapPage(unsigned int vpn, int frame);
+					// Page "vpn" is now in "frame"
+#ifdef VM
+    void UnmapPage(unsigned int vpn);	// Page "vpn" is out of memory
+#endif
+    int GetSwapSlot(unsigned int vpn);
+    void SetSwapSlot(unsigned int vpn, int slot);
+					// Where page "vpn" is saved in the
+					// swap file; -1 if it isn't
+    NoffImage *GetImage() { return image; }
+    SharedText *GetText() { return text; }
+    bool CopyOnWrite(int virtualAddr);	// Give us a private copy of the
+					// shared page "virtualAddr" is in
+    bool IsCopyOnWrite(unsigned int vpn);
+    void SetCopyOnWrite(unsigned int vpn);
+					// Share page "vpn" copy-on-write
     PCB* pcb; // the process that owns this addresspace
+    ProfileImage *profile;		// where the profiler counts what we
+					// execute, NULL if not profiling
 
   private:
+    bool IsMapped(unsigned int vpn);	// Is page "vpn" in the program,
+					// heap or stack?
+    bool GrowStack(unsigned int vpn);	// Grow the stack down to "vpn",
+					// if it may
+    bool FaultIn(unsigned int vpn);	// Bring page "vpn" into memory
+    int UserPage(unsigned int vpn, bool writing);
+					// The physical page holding "vpn",
+					// for the kernel; -1 if none can
+    void DropPage(unsigned int vpn);	// Give back page "vpn"
+    unsigned int MapAreaBase();		// First page for shared segments
+					// and mapped files
+    int FindRoom(unsigned int n);	// Set aside "n" pages there
+    void FreeRoom(unsigned int first, unsigned int n);
+    bool IsSharedPage(unsigned int vpn);
+					// Is page "vpn" in a shared segment?
+    MappedFile *FindFile(unsigned int vpn);
+					// The mapped file page "vpn" is in
+    void Release();			// Give back all we hold
+
     bool valid; // is AddrSpace valid
-    TranslationEntry *pageTable;	// Assume linear page table translation
-					// for now!
+    PageTable *pageTable;		// Two-level: entries for the parts
+					// of the address space in use
     unsigned int numPages;		// Number of pages in the virtual
 					// address space
+    NoffImage *image;			// the program we are running, NULL
+					// if we were restored without it
+    SharedText *text;			// our code pages, shared with others
+					// running the program; NULL if none
+    unsigned int heapStart;		// first page of the heap, just past
+					// the program
+    unsigned int breakAddr;		// the end of the heap
+    unsigned int stackBottom;		// lowest page of the stack
+    AttachedSegment *attached;		// the shared segments we map
+    AttachedSegment *created;		// the ones we created, and hold
+					// until we go (not mapped)
+    MappedFile *mapped;			// the files we map
+    BitMap *mapAreaMap;			// which pages of the room for
+					// them are in use
+#ifdef USE_TLB
+    int asid;				// tags our entries in the TLB
+#endif
 };
 
 #endif // ADDRSPACE_H
\ No newline at end of file
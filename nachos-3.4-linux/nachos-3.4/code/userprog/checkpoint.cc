@@ -0,0 +1,528 @@
+// checkpoint.cc
+//	Routines to save the state of all the user programs to a file,
+//	and to re-create them from the file, in another run of Nachos.
+//
+//	The file is laid out as:
+//
+//		header (with the offset of main memory filled in last)
+//		statistics
+//		pending interrupts: count, then type and delay of each
+//		PCBs: count, then for each its pid, parent pid, exit
+//		    status, and the kind, offset and name of each FD
+//		threads: count, then for each its pid, user registers,
+//		    number of pages, where the heap starts and ends and
+//		    the stack ends, page table (for each page, a flag,
+//		    then its entry if it has one), profile name and
+//		    executable name; with VM, also each page that is in
+//		    the swap file: a flag, then its contents
+//		main memory, starting at a multiple of CheckpointAlign
+//
+//	Everything is in host byte order: a checkpoint is only meant to
+//	be restored by the same Nachos binary that wrote it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "checkpoint.h"
+#include "system.h"
+#include "addrspace.h"
+
+#include <fcntl.h>
+
+#define CheckpointMagic	0x4e434b50	// "NCKP"
+#define CheckpointAlign	65536		// alignment of main memory in the
+					// file; a multiple of the page
+					// size of any host we run on
+
+#define MaxPendingSaved	16		// most pending interrupts we keep
+
+// Kinds of file descriptor slots.
+enum FDKind { FDClosed, FDConsole, FDFile };
+
+// The start of a checkpoint file.
+
+class CheckpointHeader {
+  public:
+    int magic;			// CheckpointMagic
+    int statsSize;		// sizeof(Statistics) in the writer, to
+				// reject files from a different build
+    int numPhysPages;		// size of main memory, in pages
+    int memoryOffset;		// where main memory starts in the file
+};
+
+extern void startChildProcess(int dummy);	// in exception.cc
+
+//----------------------------------------------------------------------
+// WriteInt, ReadInt, WriteString, ReadString
+//	Save or load one value of the checkpoint.  A string is saved as
+//	its length (-1 for NULL) followed by its characters.
+//----------------------------------------------------------------------
+
+static void
+WriteInt(int fd, int value)
+{
+    WriteFile(fd, (char *) &value, sizeof(int));
+}
+
+static int
+ReadInt(int fd)
+{
+    int value;
+
+    Read(fd, (char *) &value, sizeof(int));
+    return value;
+}
+
+static void
+WriteString(int fd, const char *str)
+{
+    if (str == NULL) {
+	WriteInt(fd, -1);
+	return;
+    }
+    WriteInt(fd, strlen(str));
+    WriteFile(fd, str, strlen(str));
+}
+
+static char *
+ReadString(int fd)
+{
+    int length = ReadInt(fd);
+    char *str;
+
+    if (length < 0)
+	return NULL;
+    str = new char[length + 1];
+    Read(fd, str, length);
+    str[length] = '\0';
+    return str;
+}
+
+// The user threads being saved: the one taking the checkpoint first,
+// then the ready list in order.
+
+static Thread *savedThreads[MAX_PROCESSES];
+static int numSavedThreads;
+
+//----------------------------------------------------------------------
+// NoteThread
+//	Add a ready thread to those being saved, if it runs a user program.
+//	Called through Scheduler::MapReady; "arg" is the thread.
+//----------------------------------------------------------------------
+
+static void
+NoteThread(int arg)
+{
+    Thread *thread = (Thread *) arg;
+
+    if (thread->space == NULL)
+	return;			// kernel thread: nothing to save
+    ASSERT(numSavedThreads < MAX_PROCESSES);
+    savedThreads[numSavedThreads++] = thread;
+}
+
+//----------------------------------------------------------------------
+// IsSaved
+//	Return TRUE if the process "pcb" has a thread being saved.
+//----------------------------------------------------------------------
+
+static bool
+IsSaved(PCB *pcb)
+{
+    for (int i = 0; i < numSavedThreads; i++)
+	if (savedThreads[i]->space->pcb == pcb)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// HasPipes
+//	Return TRUE if the process "pcb" has either end of a pipe open:
+//	what is in a pipe can't be saved.
+//----------------------------------------------------------------------
+
+static bool
+HasPipes(PCB *pcb)
+{
+    for (int fid = 0; fid < MAX_PROC_OFDS; fid++)
+	if (pcb->GetOFD(fid) != NULL && pcb->GetOFD(fid)->IsPipe())
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// WriteCheckpoint
+//	Save the state of all the user programs into the file "fileName".
+//	Called from the Checkpoint system call; the calling thread is
+//	saved as if the call had returned 1, so that it can tell, once
+//	restored, that it is running from the checkpoint.
+//
+//	A process whose thread is blocked (say, waiting for the console)
+//	can't be resumed from user mode, so it is saved as killed.
+//
+//	Shared memory segments, mapped files and pipes aren't saved, so
+//	neither is anything once a running process has one.  (A blocked
+//	process's pipes are saved as closed, as it is saved as killed.)
+//
+//	Returns FALSE if there was nothing to save, it can't be saved, or
+//	"fileName" can't be created.
+//----------------------------------------------------------------------
+
+bool
+WriteCheckpoint(char *fileName)
+{
+    CheckpointHeader header;
+    IntType types[MaxPendingSaved];
+    int delays[MaxPendingSaved];
+    int fd, i, n, pid, fid;
+
+    if (currentThread->space == NULL)
+	return FALSE;
+
+    // the threads to save: us first, so we are the first to run again
+    numSavedThreads = 0;
+    savedThreads[numSavedThreads++] = currentThread;
+    scheduler->MapReady(NoteThread);
+    for (i = 0; i < numSavedThreads; i++)
+	if (savedThreads[i]->space->HasMappings()) {
+	    printf("Checkpoint: process [%d] has shared memory or files "
+		   "mapped\n",
+		   savedThreads[i]->space->pcb->GetPID());
+	    return FALSE;
+	} else if (HasPipes(savedThreads[i]->space->pcb)) {
+	    printf("Checkpoint: process [%d] has a pipe open\n",
+		   savedThreads[i]->space->pcb->GetPID());
+	    return FALSE;
+	}
+    machine->SyncTLB();		// the page tables get the TLB's dirty bits
+
+    // not OpenForWrite, which asserts: a bad name is the user's mistake
+    fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+	printf("Checkpoint: can't create %s\n", fileName);
+	return FALSE;
+    }
+    header.magic = CheckpointMagic;
+    header.statsSize = sizeof(Statistics);
+    header.numPhysPages = machine->numPhysPages;
+    header.memoryOffset = 0;
+    WriteFile(fd, (char *) &header, sizeof(header));
+
+    // 1. The clock, and when the devices will next interrupt
+    WriteFile(fd, (char *) stats, sizeof(Statistics));
+    n = interrupt->GetPending(types, delays, MaxPendingSaved);
+    WriteInt(fd, n);
+    for (i = 0; i < n; i++) {
+	WriteInt(fd, types[i]);
+	WriteInt(fd, delays[i]);
+    }
+
+    // 2. The PCB tree, with each process's open files
+    for (n = 0, pid = 0; pid < MAX_PROCESSES; pid++)
+	if (pcbManager->GetPCB(pid) != NULL)
+	    n++;
+    WriteInt(fd, n);
+    for (pid = 0; pid < MAX_PROCESSES; pid++) {
+	PCB *pcb = pcbManager->GetPCB(pid);
+
+	if (pcb == NULL)
+	    continue;
+	WriteInt(fd, pid);
+	WriteInt(fd, (pcb->GetParent() == NULL) ? -1 :
+		 pcb->GetParent()->GetPID());
+	if (!pcb->HasExited() && !IsSaved(pcb)) {
+	    printf("Checkpoint: process [%d] is blocked, saved as killed\n",
+		   pid);
+	    WriteInt(fd, 9999);
+	} else
+	    WriteInt(fd, pcb->exitStatus);
+
+	for (fid = 0; fid < MAX_PROC_OFDS; fid++) {
+	    OFD *ofd = pcb->GetOFD(fid);
+
+	    if (ofd == NULL || ofd->IsPipe())	// blocked, saved as killed
+		WriteInt(fd, FDClosed);
+	    else if (ofd->IsConsole())
+		WriteInt(fd, FDConsole);
+	    else {
+		WriteInt(fd, FDFile);
+		WriteInt(fd, ofd->GetOffset());
+		WriteString(fd, ofd->GetName());
+	    }
+	}
+    }
+
+    // 3. The threads: registers and page tables
+    WriteInt(fd, numSavedThreads);
+    for (i = 0; i < numSavedThreads; i++) {
+	Thread *thread = savedThreads[i];
+	AddrSpace *space = thread->space;
+	int registers[NumTotalRegs];
+
+	for (int r = 0; r < NumTotalRegs; r++)
+	    registers[r] = (thread == currentThread) ?
+		machine->ReadRegister(r) : thread->ReadUserRegister(r);
+	if (thread == currentThread) {
+	    // return 1 from the system call, past the syscall instruction
+	    registers[2] = 1;
+	    registers[PrevPCReg] = registers[PCReg];
+	    registers[PCReg] = registers[PrevPCReg] + 4;
+	    registers[NextPCReg] = registers[PrevPCReg] + 8;
+	}
+
+	WriteInt(fd, space->pcb->GetPID());
+	WriteFile(fd, (char *) registers, sizeof(registers));
+	WriteInt(fd, space->GetNumPages());
+	WriteInt(fd, space->GetHeapStart());
+	WriteInt(fd, space->GetBreak());
+	WriteInt(fd, space->GetStackBottom());
+	for (unsigned int vpn = 0; vpn < space->GetNumPages(); vpn++) {
+	    PageTableEntry *entry = space->GetPageTable()->Lookup(vpn);
+
+	    WriteInt(fd, entry != NULL);
+	    if (entry != NULL)
+		WriteFile(fd, (char *) entry, sizeof(PageTableEntry));
+	}
+	WriteString(fd, (space->profile == NULL) ? NULL :
+		    space->profile->name);
+	WriteString(fd, (space->GetImage() == NULL) ? NULL :
+		    space->GetImage()->GetName());
+#ifdef VM
+	for (unsigned int vpn = 0; vpn < space->GetNumPages(); vpn++) {
+	    int slot = space->GetSwapSlot(vpn);
+
+	    WriteInt(fd, slot != -1);
+	    if (slot != -1) {
+		char page[PageSize];
+
+		pager->GetSwap()->ReadPage(slot, page);
+		WriteFile(fd, page, PageSize);
+	    }
+	}
+#endif
+    }
+
+    // 4. Main memory: only the pages in use are written; the rest of
+    // the file is left as a hole, which reads back as zeroes.  The
+    // last byte is always written, so the file covers all of memory.
+    header.memoryOffset = divRoundUp(Tell(fd), CheckpointAlign)
+	* CheckpointAlign;
+    for (i = 0; i < machine->numPhysPages; i++)
+	if (mm->PageInUse(i)) {
+	    Lseek(fd, header.memoryOffset + i * PageSize, SEEK_SET);
+	    WriteFile(fd, &machine->mainMemory[i * PageSize], PageSize);
+	}
+    Lseek(fd, header.memoryOffset + machine->memorySize - 1, SEEK_SET);
+    WriteFile(fd, &machine->mainMemory[machine->memorySize - 1], 1);
+
+    Lseek(fd, 0, SEEK_SET);
+    WriteFile(fd, (char *) &header, sizeof(header));
+    Close(fd);
+
+    DEBUG('e', "Checkpoint %s: %d threads, memory at offset %d\n",
+	  fileName, numSavedThreads, header.memoryOffset);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ReadHeader
+//	Open checkpoint "fileName" and read its header.
+//
+//	Returns the open file, or -1 if it isn't a checkpoint written by
+//	this build of Nachos.
+//----------------------------------------------------------------------
+
+static int
+ReadHeader(char *fileName, CheckpointHeader *header)
+{
+    int fd = OpenForReadWrite(fileName, FALSE);
+
+    if (fd < 0)
+	return -1;
+    if (ReadPartial(fd, (char *) header, sizeof(CheckpointHeader))
+	    != sizeof(CheckpointHeader)
+	|| header->magic != CheckpointMagic
+	|| header->statsSize != sizeof(Statistics)) {
+	Close(fd);
+	return -1;
+    }
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// CheckpointPhysPages
+//	Return the size of physical memory, in pages, that checkpoint
+//	"fileName" was taken with, so that the machine can be built to
+//	match before it is restored.  Returns 0 if the file is unusable.
+//----------------------------------------------------------------------
+
+int
+CheckpointPhysPages(char *fileName)
+{
+    CheckpointHeader header;
+    int fd = ReadHeader(fileName, &header);
+
+    if (fd < 0)
+	return 0;
+    Close(fd);
+    return header.numPhysPages;
+}
+
+//----------------------------------------------------------------------
+// RestoreCheckpoint
+//	Re-create the user programs saved in checkpoint "fileName".  Each
+//	saved thread is forked, ready to continue in user mode where it
+//	left off; they run once the caller (the main thread) finishes.
+//----------------------------------------------------------------------
+
+void
+RestoreCheckpoint(char *fileName)
+{
+    CheckpointHeader header;
+    Statistics saved;
+    IntType types[MaxPendingSaved];
+    int delays[MaxPendingSaved];
+    int parents[MAX_PROCESSES];
+    int fd, i, n, pid, fid;
+
+    fd = ReadHeader(fileName, &header);
+    if (fd < 0) {
+	printf("Unable to restore checkpoint %s\n", fileName);
+	return;
+    }
+    ASSERT(header.numPhysPages == machine->numPhysPages);
+
+    // 1. Set the clock back, keeping the devices' interrupts as far
+    // in the future as they were
+    Read(fd, (char *) &saved, sizeof(Statistics));
+    n = ReadInt(fd);
+    ASSERT(n <= MaxPendingSaved);
+    for (i = 0; i < n; i++) {
+	types[i] = (IntType) ReadInt(fd);
+	delays[i] = ReadInt(fd);
+    }
+    interrupt->RestorePending(saved.totalTicks, types, delays, n);
+    *stats = saved;
+
+    // 2. The PCB tree.  The PCBs come back with the console open as
+    // FDs 0 and 1; make each FD what it was.
+    for (pid = 0; pid < MAX_PROCESSES; pid++)
+	parents[pid] = -1;
+    n = ReadInt(fd);
+    for (i = 0; i < n; i++) {
+	pid = ReadInt(fd);
+	PCB *pcb = pcbManager->AllocatePCB(pid);
+
+	parents[pid] = ReadInt(fd);
+	pcb->exitStatus = ReadInt(fd);
+	for (fid = 0; fid < MAX_PROC_OFDS; fid++) {
+	    int kind = ReadInt(fd);
+
+	    if (kind == FDConsole)
+		continue;		// as the PCB starts out
+	    if (pcb->GetOFD(fid) != NULL)
+		pcb->DeallocateFD(fid);
+	    if (kind == FDFile) {
+		unsigned int offset = ReadInt(fd);
+		char *name = ReadString(fd);
+
+		if (pcb->AllocateFD(fid, name))
+		    pcb->GetOFD(fid)->SetOffset(offset);
+		else
+		    printf("Process [%d]: unable to reopen %s\n", pid, name);
+		delete [] name;
+	    }
+	}
+    }
+    for (pid = 0; pid < MAX_PROCESSES; pid++)
+	if (parents[pid] != -1) {
+	    PCB *parent = pcbManager->GetPCB(parents[pid]);
+
+	    pcbManager->GetPCB(pid)->SetParent(parent);
+	    parent->AddChild(pcbManager->GetPCB(pid));
+	}
+
+    // 3. The threads, each with its address space
+    n = ReadInt(fd);
+    for (i = 0; i < n; i++) {
+	int registers[NumTotalRegs];
+	unsigned int numPages;
+	PageTable *pageTable;
+	char threadName[20];
+
+	pid = ReadInt(fd);
+	Read(fd, (char *) registers, sizeof(registers));
+	numPages = ReadInt(fd);
+	unsigned int heapStart = ReadInt(fd);
+	unsigned int breakAddr = ReadInt(fd);
+	unsigned int stackBottom = ReadInt(fd);
+	pageTable = new PageTable(numPages);
+	for (unsigned int vpn = 0; vpn < numPages; vpn++)
+	    if (ReadInt(fd)) {
+		PageTableEntry *entry = pageTable->Entry(vpn);
+
+		Read(fd, (char *) entry, sizeof(PageTableEntry));
+		entry->swapSlot = -1;	// the swap file is rebuilt below
+		if (entry->valid)
+		    mm->ClaimPage(entry->physicalPage);
+	    }
+	char *profileName = ReadString(fd);
+	char *imageName = ReadString(fd);
+	NoffImage *image = NULL;
+	if (imageName != NULL) {
+	    image = imageCache->Open(imageName);
+	    if (image == NULL)
+		printf("Process [%d]: unable to reopen %s\n", pid, imageName);
+	    delete [] imageName;
+	}
+
+	AddrSpace *space = new AddrSpace(pageTable, image, heapStart,
+					 breakAddr, stackBottom);
+	space->pcb = pcbManager->GetPCB(pid);
+	for (unsigned int vpn = 0; vpn < numPages; vpn++) {
+	    PageTableEntry *entry = pageTable->Lookup(vpn);
+
+	    if (entry != NULL && entry->valid)
+		mm->AddMapping(entry->physicalPage, space, vpn);
+	}
+#ifdef VM
+	for (unsigned int vpn = 0; vpn < numPages; vpn++)
+	    if (ReadInt(fd)) {
+		char page[PageSize];
+		int slot = pager->GetSwap()->Allocate();
+
+		ASSERT(slot != -1);
+		Read(fd, page, PageSize);
+		pager->GetSwap()->WritePage(slot, page);
+		space->SetSwapSlot(vpn, slot);
+	    }
+#endif
+	if (profileName != NULL && profiler != NULL)
+	    space->profile = profiler->FindImage(profileName);
+	delete [] profileName;
+
+	sprintf(threadName, "restoredThread_%d", pid);
+	Thread *thread = new Thread(strdup(threadName));
+	thread->space = space;
+	for (int r = 0; r < NumTotalRegs; r++)
+	    machine->WriteRegister(r, registers[r]);
+	thread->SaveUserState();
+	thread->Fork(startChildProcess, 0);
+    }
+
+    // 4. Main memory, mapped straight from the file if the host can
+    if (!MapLazyArray(machine->mainMemory, machine->memorySize, fd,
+		      header.memoryOffset)) {
+	Lseek(fd, header.memoryOffset, SEEK_SET);
+	Read(fd, machine->mainMemory, machine->memorySize);
+    }
+    for (i = 0; i < machine->numPhysPages; i++)
+	machine->InvalidateDecodedPage(i);
+    mm->ForgetZeroedPages();	// the free pages hold what they held then
+    Close(fd);
+
+    printf("Restored checkpoint %s: %d threads at time %d\n",
+	   fileName, n, stats->totalTicks);
+}
@@ -0,0 +1,39 @@
+// checkpoint.h
+//	Routines to save the state of all the user programs to a file,
+//	and to start Nachos again from that state later (see the
+//	Checkpoint system call, and the -restore flag).
+//
+//	A checkpoint holds the statistics and the clock, the timing of
+//	the pending interrupts, the PCB tree with each process's open
+//	files, and, for every user thread that was running or ready to
+//	run, its user registers and page table.  Main memory is stored
+//	last, page aligned, so that restoring it is a single mmap of the
+//	file: its pages are only read in as the restored programs touch
+//	them.
+//
+//	Kernel thread stacks aren't saved: they hold host addresses that
+//	mean nothing to another run of Nachos.  Instead each restored
+//	thread starts out fresh, returning to user mode at the saved
+//	registers, just like a forked process does.  A thread that was
+//	ready but inside a system call (Join or Yield) hasn't advanced
+//	its PC yet, so it simply makes the system call again.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "copyright.h"
+
+extern bool WriteCheckpoint(char *fileName);	// Save the state of the
+						// user programs, as of
+						// the current system call
+extern int CheckpointPhysPages(char *fileName);	// Size of physical memory
+						// in a checkpoint, or 0
+extern void RestoreCheckpoint(char *fileName);	// Re-create the user
+						// programs from a
+						// checkpoint
+
+#endif // CHECKPOINT_H
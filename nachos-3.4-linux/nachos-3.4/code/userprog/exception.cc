@@ -26,6 +26,9 @@
 #include "syscall.h"
 #include "addrspace.h"
 #include "thread.h"
+#include "checkpoint.h"
+
+#define MaxStringLength 256  // longest string argument, with its '\0'
 
 //---------------------------------------------------------------------
 // doExit
@@ -41,17 +44,20 @@ void doExit(int status) {
     // 1. Set the exit status
     currentThread->space->pcb->exitStatus = status;
 
-    // 2. Make changes to the PCB tree
+    // 2. Close the open files, so the other ends of pipes see us go
     PCB* pcb = currentThread->space->pcb;
+    pcb->CloseFiles();
+
+    // 3. Make changes to the PCB tree
     pcb->DeleteExitedChildrenSetParentNull();
 
-    // 3. Delete PCB if necessary
+    // 4. Delete PCB if necessary
     if(pcb->GetParent() == NULL) pcbManager->DeallocatePCB(pcb);
 
-    // 4. Delete address space
+    // 5. Delete address space
     delete currentThread->space;
 
-    // 5. Delete thread of execution
+    // 6. Delete thread of execution
     printf("Process [%d] exits with status [%d]\n", pid, status);
     currentThread->Finish();
 
@@ -161,8 +167,8 @@ int doExec(char* filename) {
     printf("System Call: [%d] invoked Exec\n", pid);
     AddrSpace *current_addrspace = currentThread->space;
 
-    // 1. Read the executable
-    OpenFile *executable = fileSystem->Open(filename);
+    // 1. Read the executable, unless it was run recently
+    NoffImage *executable = imageCache->Open(filename);
     if (executable == NULL)
     {
         DEBUG('e', "Process [%d] Exec: failed. Unable to open file %s\n",
@@ -178,6 +184,8 @@ int doExec(char* filename) {
 
     AddrSpace *executable_addrspace = new AddrSpace(executable);
     executable_addrspace->pcb = current_pcb;
+    if (profiler != NULL)
+        executable_addrspace->profile = profiler->FindImage(filename);
     currentThread->space = executable_addrspace;
     if(!executable_addrspace->IsValid())
     {
@@ -194,8 +202,6 @@ int doExec(char* filename) {
         return -1;
     }
 
-    delete executable;
-
     // 3. Set the registers, pageTable & pageTableSize for the machine
     executable_addrspace->InitRegisters();
     executable_addrspace->RestoreState();
@@ -250,6 +256,11 @@ int doJoin(int join_pid) {
 // doKill
 //  Helper function for performing the Kill system call
 //
+//  A process that is ready to run is deleted straight away.  One that
+//  is blocked in the kernel (say, on a pipe) can't be, since it is in
+//  the middle of a system call: it is marked killed and woken up, and
+//  exits by itself before it returns to user mode.
+//
 //  Returns 0 if successful else -1
 //--------------------------------------------------------------------
 
@@ -268,28 +279,41 @@ int doKill (int kill_pid) {
         PCB *killed_pcb = pcbManager->GetPCB(kill_pid);
 
         // 2. Check if the process to be killed exists
-        if(killed_pcb == NULL)
+        if(killed_pcb == NULL || killed_pcb->HasExited())
         {
             printf("Process [%d] cannot kill process [%d]: doesn't exist\n",
                    pid, kill_pid);
             return -1;
         }
 
-        // 3. Set the exit status
+        // 3. Take its thread off the ready list; if it isn't there, it
+        //    is blocked, and exits when it wakes up
+        Thread *kp_thread = scheduler->UnSchedule(kill_pid);
+        if(kp_thread == NULL)
+        {
+            killed_pcb->Kill();
+            printf("Process [%d] killed blocked process [%d]\n", pid,
+                   kill_pid);
+            return 0;
+        }
+
+        // 4. Set the exit status
         killed_pcb->exitStatus = 9999;
 
-        // 3. Make changes to the PCB tree
+        // 5. Close its open files
+        killed_pcb->CloseFiles();
+
+        // 6. Make changes to the PCB tree
         killed_pcb->DeleteExitedChildrenSetParentNull();
         PCB *kp_parent_pcb = killed_pcb->GetParent();
 
-        // 4. Delete PCB if necessary
+        // 7. Delete PCB if necessary
         if(kp_parent_pcb == NULL) pcbManager->DeallocatePCB(killed_pcb);
 
-        // 5. Delete address space
-        Thread *kp_thread = scheduler->UnSchedule(kill_pid);
+        // 8. Delete address space
         delete kp_thread->space;
 
-        // 6. Delete thread of execution
+        // 9. Delete thread of execution
         delete kp_thread;
 
         printf("Process [%d] killed process [%d]\n", pid, kill_pid);
@@ -308,6 +332,172 @@ void doYield() {
     currentThread->Yield();
 }
 
+//--------------------------------------------------------------------
+// doCheckpoint
+//  Helper function for performing the Checkpoint system call
+//
+//  "fileName" is the host file to save the checkpoint in
+//
+//  Returns 0 if successful else -1.  When the checkpoint is restored,
+//  the call returns 1 instead (see WriteCheckpoint).
+//--------------------------------------------------------------------
+
+int doCheckpoint(char *fileName) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked Checkpoint\n", pid);
+
+    if (!WriteCheckpoint(fileName))
+    {
+        DEBUG('e', "Process [%d] Checkpoint: failed\n", pid);
+        return -1;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------
+// doSbrk
+//  Helper function for performing the Sbrk system call
+//
+//  "increment" is how many bytes to grow the heap by
+//
+//  Returns the old end of the heap, or -1 if it can't be moved
+//--------------------------------------------------------------------
+
+int doSbrk(int increment) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked Sbrk\n", pid);
+
+    int ret = currentThread->space->Sbrk(increment);
+    if (ret == -1)
+        DEBUG('e', "Process [%d] Sbrk: no room for %d bytes\n", pid,
+              increment);
+    return ret;
+}
+
+//--------------------------------------------------------------------
+// doShmCreate
+//  Helper function for performing the ShmCreate system call
+//
+//  "name" is the name of the segment to create
+//  "size" is its size, in bytes
+//
+//  Returns 0 if successful else -1
+//--------------------------------------------------------------------
+
+int doShmCreate(char *name, int size) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked ShmCreate\n", pid);
+
+    SharedSegment *segment = NULL;
+    if (strlen(name) <= MaxSegmentNameLength)
+        segment = segmentTable->Create(name, size);
+    if (segment == NULL)
+    {
+        DEBUG('e', "Process [%d] ShmCreate: can't create %s\n", pid, name);
+        return -1;
+    }
+    currentThread->space->HoldSegment(segment);
+    return 0;
+}
+
+//--------------------------------------------------------------------
+// doShmAttach
+//  Helper function for performing the ShmAttach system call
+//
+//  "name" is the name of the segment to attach
+//
+//  Returns the virtual address the segment is mapped at, else -1
+//--------------------------------------------------------------------
+
+int doShmAttach(char *name) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked ShmAttach\n", pid);
+
+    SharedSegment *segment = segmentTable->Attach(name);
+    if (segment == NULL)
+    {
+        DEBUG('e', "Process [%d] ShmAttach: no segment %s\n", pid, name);
+        return -1;
+    }
+    int addr = currentThread->space->AttachSegment(segment);
+    if (addr == -1)
+    {
+        DEBUG('e', "Process [%d] ShmAttach: no room for %s\n", pid, name);
+        segmentTable->Detach(segment);
+    }
+    return addr;
+}
+
+//--------------------------------------------------------------------
+// doShmDetach
+//  Helper function for performing the ShmDetach system call
+//
+//  "virtAddr" is where the segment to detach is mapped
+//
+//  Returns 0 if successful else -1
+//--------------------------------------------------------------------
+
+int doShmDetach(int virtAddr) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked ShmDetach\n", pid);
+
+    if (!currentThread->space->DetachSegment(virtAddr))
+    {
+        DEBUG('e', "Process [%d] ShmDetach: nothing at 0x%x\n", pid,
+              virtAddr);
+        return -1;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------
+// doMmap
+//  Helper function for performing the Mmap system call
+//
+//  "id" is the id (file descriptor) of the file to map
+//
+//  Returns the virtual address the file is mapped at, else -1
+//--------------------------------------------------------------------
+
+int doMmap(OpenFileId id) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked Mmap\n", pid);
+
+    OFD *ofd = currentThread->space->pcb->GetOFD((int) id);
+    if (ofd == NULL || ofd->IsConsole() || ofd->IsPipe())
+    {
+        DEBUG('e', "Process [%d] Mmap: can't map file ID [%d]\n", pid, id);
+        return -1;
+    }
+    int addr = currentThread->space->MapFile(ofd->GetVNode());
+    if (addr == -1)
+        DEBUG('e', "Process [%d] Mmap: no room for %s\n", pid,
+              ofd->GetName());
+    return addr;
+}
+
+//--------------------------------------------------------------------
+// doMunmap
+//  Helper function for performing the Munmap system call
+//
+//  "virtAddr" is where the file to unmap is mapped
+//
+//  Returns 0 if successful else -1
+//--------------------------------------------------------------------
+
+int doMunmap(int virtAddr) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked Munmap\n", pid);
+
+    if (!currentThread->space->UnmapFile(virtAddr))
+    {
+        DEBUG('e', "Process [%d] Munmap: nothing at 0x%x\n", pid,
+              virtAddr);
+        return -1;
+    }
+    return 0;
+}
+
 //--------------------------------------------------------------------
 // incrementPC
 //  Increment the program counter by one instruction.
@@ -327,27 +517,24 @@ void incrementPC() {
 }
 
 
-// perform MMU translation to access physical memory
-char* readString(int virtualAddr) {
-    int i = 0;
-    char* str = new char[256];
-    unsigned int physicalAddr = currentThread->space->Translate(virtualAddr);
+//--------------------------------------------------------------------
+// readString
+//  Copy the string at "virtualAddr" in user memory, such as a file
+//  name, into "str", which has room for MaxStringLength bytes.
+//
+//  Returns false if the string is too long, or isn't all in the
+//  address space
+//--------------------------------------------------------------------
 
-    // Need to get one byte at a time since the string may straddle multiple non-contiguous pages
-    bcopy(&(machine->mainMemory[physicalAddr]),&str[i],1);
-    while(str[i] != '\0' && i != 256-1)
+bool readString(int virtualAddr, char *str) {
+    if (currentThread->space->CopyInString(virtualAddr, str,
+                                           MaxStringLength) == -1)
     {
-        virtualAddr++;
-        i++;
-        physicalAddr = currentThread->space->Translate(virtualAddr);
-        bcopy(&(machine->mainMemory[physicalAddr]),&str[i],1);
+        DEBUG('e', "Process [%d]: bad string argument at 0x%x\n",
+              currentThread->space->pcb->GetPID(), virtualAddr);
+        return false;
     }
-    if(i != 256-1 && str[i] != '\0')
-    {
-        str[i] = '\0';
-    }
-
-    return str;
+    return true;
 }
 
 //----------------------------------------------------------------------
@@ -360,9 +547,11 @@ char* readString(int virtualAddr) {
 void doCreate(char* fileName) {
     printf("Syscall Call: [%d] invoked Create.\n",
             currentThread->space->pcb->GetPID());
-    char path[256] = "../test/";
+    char path[sizeof("../test/") + MaxStringLength] = "../test/";
     strcat((char *) path, fileName);
     fileSystem->Create(path, 0);
+    imageCache->Invalidate(path);	// in case it was a program, by
+					// whatever name it was run
 }
 
 //----------------------------------------------------------------------
@@ -377,9 +566,13 @@ void doCreate(char* fileName) {
 OpenFileId doOpen(char* fileName) {
     printf("Syscall Call: [%d] invoked Open.\n",
             currentThread->space->pcb->GetPID());
-    char path[256] = "../test/";
+    char path[sizeof("../test/") + MaxStringLength] = "../test/";
     strcat((char *) path, fileName);
-    int fid = currentThread->space->pcb->AllocateFD(path);
+    // by its canonical name, so that every alias shares one vnode, and
+    // writes through it invalidate the image cache entry
+    char *name = CanonicalPath(path);
+    int fid = currentThread->space->pcb->AllocateFD(name);
+    delete [] name;
     return (OpenFileId) fid;
 }
 
@@ -401,11 +594,10 @@ int doRead(int virtAddr, int nBytes, OpenFileId id) {
     int pid = currentThread->space->pcb->GetPID();
     printf("Syscall Call: [%d] invoked Read.\n", pid);
 
-    ASSERT(virtAddr > 0);
-
     if(nBytes < 0)
     {
         DEBUG('e', "Process [%d] Read: failed. Invalid size argument", pid);
+        return -1;
     }
 
     // 1. Get Open File Descriptor
@@ -417,7 +609,7 @@ int doRead(int virtAddr, int nBytes, OpenFileId id) {
         return -1;
     }
 
-    // 2. Read from file
+    // 2. Read from file; -1 if the buffer isn't all in our memory
     int readBytes = ofd->Read(virtAddr, nBytes);
 
     return readBytes;
@@ -438,23 +630,22 @@ int doWrite(int virtAddr, int nBytes, OpenFileId id) {
     int pid = currentThread->space->pcb->GetPID();
     printf("Syscall Call: [%d] invoked Write.\n", pid);
 
-    ASSERT(virtAddr > 0);
-
     if(nBytes < 0)
     {
-        DEBUG('e', "Process [%d] Read: failed. Invalid size argument", pid);
+        DEBUG('e', "Process [%d] Write: failed. Invalid size argument", pid);
+        return -1;
     }
 
     // 1. Get Open File Descriptor
     OFD *ofd = currentThread->space->pcb->GetOFD((int) id);
     if (ofd == NULL)
     {
-        DEBUG('e', "Process [%d] Read: failed. File ID [%d] is invalid",
+        DEBUG('e', "Process [%d] Write: failed. File ID [%d] is invalid",
                 pid, id);
         return -1;
     }
 
-    // 3. Write to file
+    // 2. Write to file; -1 if the buffer isn't all in our memory
     int writeBytes = ofd->Write(virtAddr, nBytes);
 
     return writeBytes;
@@ -473,6 +664,42 @@ void doClose(OpenFileId id) {
     currentThread->space->pcb->DeallocateFD((int) id);
 }
 
+//----------------------------------------------------------------------
+// doPipe
+//  Helper function for the pipe system call
+//
+//  "virtAddr" is where to store the ids of the two ends: the end read
+//  from, then the end written to
+//
+//  Returns 0 if successful else -1
+//----------------------------------------------------------------------
+
+int doPipe(int virtAddr) {
+    int pid = currentThread->space->pcb->GetPID();
+    printf("System Call: [%d] invoked Pipe\n", pid);
+
+    int readFid, writeFid;
+    if (!currentThread->space->pcb->AllocatePipe(&readFid, &writeFid))
+    {
+        DEBUG('e', "Process [%d] Pipe: failed. No file ids left\n", pid);
+        return -1;
+    }
+
+    int ids[2];
+    ids[0] = WordToMachine(readFid);
+    ids[1] = WordToMachine(writeFid);
+    if (currentThread->space->CopyOut((char *) ids, virtAddr,
+                                      sizeof(ids)) == -1)
+    {
+        DEBUG('e', "Process [%d] Pipe: failed. Bad address 0x%x\n", pid,
+              virtAddr);
+        currentThread->space->pcb->DeallocateFD(readFid);
+        currentThread->space->pcb->DeallocateFD(writeFid);
+        return -1;
+    }
+    return 0;
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -512,9 +739,10 @@ ExceptionHandler(ExceptionType which)
         machine->WriteRegister(2, ret);
         incrementPC();
     } else if ((which == SyscallException) && (type == SC_Exec)) {
-        int virtAddr = machine->ReadRegister(4);
-        char* fileName = readString(virtAddr);
-        int ret = doExec(fileName);
+        char fileName[MaxStringLength];
+        int ret = -1;
+        if (readString(machine->ReadRegister(4), fileName))
+            ret = doExec(fileName);
         machine->WriteRegister(2, ret);
         incrementPC();
     } else if ((which == SyscallException) && (type == SC_Join)) {
@@ -529,14 +757,15 @@ ExceptionHandler(ExceptionType which)
         doYield();
         incrementPC();
     } else if((which == SyscallException) && (type == SC_Create)) {
-        int virtAddr = machine->ReadRegister(4);
-        char *fileName = readString(virtAddr);
-        doCreate(fileName);
+        char fileName[MaxStringLength];
+        if (readString(machine->ReadRegister(4), fileName))
+            doCreate(fileName);
         incrementPC();
     } else if((which == SyscallException) && (type == SC_Open)) {
-        int virtAddr = machine->ReadRegister(4);
-        char *fileName = readString(virtAddr);
-        OpenFileId fid = doOpen(fileName);
+        char fileName[MaxStringLength];
+        OpenFileId fid = -1;
+        if (readString(machine->ReadRegister(4), fileName))
+            fid = doOpen(fileName);
         machine->WriteRegister(2, fid);
         incrementPC();
     } else if((which == SyscallException) && (type == SC_Write)) {
@@ -557,8 +786,72 @@ ExceptionHandler(ExceptionType which)
         OpenFileId fid = machine->ReadRegister(4);
         doClose(fid);
         incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Checkpoint)) {
+        char fileName[MaxStringLength];
+        int ret = -1;
+        if (readString(machine->ReadRegister(4), fileName))
+            ret = doCheckpoint(fileName);
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Sbrk)) {
+        int ret = doSbrk(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_ShmCreate)) {
+        char name[MaxStringLength];
+        int ret = -1;
+        if (readString(machine->ReadRegister(4), name))
+            ret = doShmCreate(name, machine->ReadRegister(5));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_ShmAttach)) {
+        char name[MaxStringLength];
+        int ret = -1;
+        if (readString(machine->ReadRegister(4), name))
+            ret = doShmAttach(name);
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_ShmDetach)) {
+        int ret = doShmDetach(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Mmap)) {
+        int ret = doMmap(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Munmap)) {
+        int ret = doMunmap(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Pipe)) {
+        int ret = doPipe(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if ((which == PageFaultException) &&
+               currentThread->space->HandlePageFault(
+                   machine->ReadRegister(BadVAddrReg))) {
+        // page brought in, or TLB refilled: return without touching the
+        // PC, so the instruction that faulted is simply executed again
+    } else if (which == PageFaultException) {
+        printf("Process [%d] cannot access 0x%x: bad address or out of "
+               "memory\n", currentThread->space->pcb->GetPID(),
+               machine->ReadRegister(BadVAddrReg));
+        doExit(-1);
+    } else if ((which == ReadOnlyException) &&
+               currentThread->space->CopyOnWrite(
+                   machine->ReadRegister(BadVAddrReg))) {
+        // wrote to a shared page, now copied: retry the write
+    } else if (which == ReadOnlyException) {
+        printf("Process [%d] cannot write to 0x%x: read-only or out of "
+               "memory\n", currentThread->space->pcb->GetPID(),
+               machine->ReadRegister(BadVAddrReg));
+        doExit(-1);
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
     }
+
+    // killed while we were blocked in the system call (see doKill)
+    if (currentThread->space->pcb->IsKilled())
+        doExit(9999);
 }
@@ -0,0 +1,217 @@
+// imagecache.cc
+//	Routines to find the executables run recently, already opened and
+//	parsed, and to drop them when they go stale.
+//
+//	The cache holds a reference to each image it keeps, and hands out
+//	another to everyone who opens it; an image dropped from the cache
+//	lives on until the last address space running it goes away.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifdef FILESYS_STUB
+extern "C" {
+#include <stdlib.h>
+#include <limits.h>
+}
+#endif
+
+#include "imagecache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// CanonicalPath
+// 	Return, in a new string, the name we use for the file "path"
+//	wherever files are compared by name -- the image and text caches,
+//	and open files -- so that aliases of one file ("./x", "a//x",
+//	"../test/x" from within test) all come out the same.
+//
+//	With the stub file system, that is the host's absolute path for
+//	the file, if it exists.  Otherwise the path is only tidied up:
+//	empty and "." components are dropped, and ".." cancels the
+//	component before it.
+//----------------------------------------------------------------------
+
+char *
+CanonicalPath(const char *path)
+{
+    char *name;
+
+#ifdef FILESYS_STUB
+    char resolved[PATH_MAX];
+
+    if (realpath(path, resolved) != NULL) {
+	name = new char[strlen(resolved) + 1];
+	strcpy(name, resolved);
+	return name;
+    }
+#endif
+    name = new char[strlen(path) + 2];
+    char *out = name;
+
+    if (*path == '/')
+	*out++ = '/';
+    char *base = out;			// where the components start
+    while (*path != '\0') {
+	const char *end = strchr(path, '/');
+	int len = (end == NULL) ? strlen(path) : end - path;
+	bool keep = (len > 0 && !(len == 1 && *path == '.'));
+
+	if (len == 2 && !strncmp(path, "..", 2)) {
+	    char *last = out;		// the component ".." cancels
+	    while (last > base && last[-1] != '/')
+		last--;
+	    if (last < out && !(out - last == 2 && !strncmp(last, "..", 2))) {
+		out = (last > base) ? last - 1 : base;
+		keep = FALSE;
+	    } else if (base > name && out == base)
+		keep = FALSE;		// "/.." is "/"
+	}
+	if (keep) {
+	    if (out > base)
+		*out++ = '/';
+	    strncpy(out, path, len);
+	    out += len;
+	}
+	path = (end == NULL) ? path + len : end + 1;
+    }
+    if (out == name)
+	*out++ = '.';
+    *out = '\0';
+    return name;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::ImageCache
+// 	Initialize an empty cache, of at most "maxImages" executables.
+//----------------------------------------------------------------------
+
+ImageCache::ImageCache(int maxImages)
+{
+    size = maxImages;
+    images = new NoffImage *[size];
+    numImages = 0;
+    lock = new Semaphore("image cache lock", 1);
+}
+
+//----------------------------------------------------------------------
+// ImageCache::~ImageCache
+// 	Let go of every cached image.
+//----------------------------------------------------------------------
+
+ImageCache::~ImageCache()
+{
+    while (numImages > 0)
+	Remove(numImages - 1);
+    delete [] images;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Open
+// 	Return the image of the executable "path", with a reference to
+//	it for the caller, and make it the most recently used.  If the
+//	cache doesn't have it, open and parse the file, and keep it in the
+//	cache, dropping the least recently used image if the cache is
+//	full.  Files that aren't NOFF executables aren't kept.
+//
+//	The file is opened either way, so that a cached image whose file
+//	is no longer the same length -- rewritten behind our back, say --
+//	is dropped and read again, as the text cache does.
+//
+//	Returns NULL if the file can't be opened.
+//----------------------------------------------------------------------
+
+NoffImage *
+ImageCache::Open(const char *path)
+{
+    NoffImage *image;
+    char *key = CanonicalPath(path);
+    int i;
+
+    lock->P();
+    OpenFile *executable = fileSystem->Open(key);
+    if (executable == NULL) {
+	lock->V();
+	delete [] key;
+	return NULL;
+    }
+    for (i = 0; i < numImages; i++)
+	if (!strcmp(images[i]->GetName(), key))
+	    break;
+    if (i < numImages && images[i]->GetLength() != executable->Length()) {
+	DEBUG('a', "Image cache: %s changed length\n", key);
+	Remove(i);
+	i = numImages;
+    }
+    if (i < numImages) {
+	stats->numImageHits++;
+	image = images[i];
+	for (; i > 0; i--)		// move it to the front
+	    images[i] = images[i - 1];
+	images[0] = image;
+	image->Hold();
+	lock->V();
+	delete executable;
+	delete [] key;
+	return image;
+    }
+
+    stats->numImageMisses++;
+    image = new NoffImage(executable, key);
+    if (image->IsValid()) {
+	if (numImages == size)
+	    Remove(numImages - 1);
+	for (i = numImages; i > 0; i--)
+	    images[i] = images[i - 1];
+	images[0] = image;
+	numImages++;
+	image->Hold();			// the cache's reference
+    }
+    lock->V();
+    delete [] key;
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Invalidate
+// 	The file "path" has been written to: drop its image, and its code
+//	pages, so the next program to run it reads it again.  "path" may
+//	be any alias of the file.
+//----------------------------------------------------------------------
+
+void
+ImageCache::Invalidate(const char *path)
+{
+    char *key = CanonicalPath(path);
+
+    lock->P();
+    for (int i = 0; i < numImages; i++)
+	if (!strcmp(images[i]->GetName(), key)) {
+	    DEBUG('a', "Image cache: %s changed\n", key);
+	    Remove(i);
+	    break;
+	}
+    lock->V();
+    textCache->Invalidate(key);
+    delete [] key;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Remove
+// 	Drop the i'th image from the cache, letting go of our reference.
+//----------------------------------------------------------------------
+
+void
+ImageCache::Remove(int i)
+{
+    NoffImage *image = images[i];
+
+    for (; i < numImages - 1; i++)
+	images[i] = images[i + 1];
+    numImages--;
+    image->Release();
+}
@@ -0,0 +1,55 @@
+// imagecache.h
+//	Data structures to keep the executables that were run recently
+//	open and parsed, for the next Exec of the same program.
+//
+//	Programs are typically run over and over (think of a shell), so
+//	rather than opening the file, reading and checking the header,
+//	and reading the segments again on every Exec, the kernel keeps
+//	the NoffImage of the last few executables run, keyed by path.
+//	When the cache is full, the least recently run executable is
+//	dropped.  Paths are compared in canonical form (see
+//	CanonicalPath), so that an alias of a file finds the same image,
+//	and a cached image whose file has changed length is read again.
+//
+//	Writing to a file, or creating it anew, drops it from the cache
+//	(and from the text cache), so the next Exec sees the new contents.
+//	Address spaces already running the old contents keep them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "copyright.h"
+#include "noffimage.h"
+#include "synch.h"
+
+#define ImageCacheSize	8		// # of executables kept
+
+// The one name of the file "path", in a new string, for comparing files
+// by name
+extern char *CanonicalPath(const char *path);
+
+class ImageCache {
+  public:
+    ImageCache(int maxImages);		// Start with no executables
+    ~ImageCache();
+
+    NoffImage *Open(const char *path);	// Return the image of the executable
+					// "path", with a reference for the
+					// caller; NULL if it can't be opened
+    void Invalidate(const char *path);	// The file "path" has changed
+
+  private:
+    void Remove(int i);			// Drop the i'th image
+
+    NoffImage **images;			// the cached images, the most
+					// recently used first
+    int numImages;			// # of images in the cache
+    int size;				// most images it will hold
+    Semaphore *lock;			// one change at a time
+};
+
+#endif // IMAGECACHE_H
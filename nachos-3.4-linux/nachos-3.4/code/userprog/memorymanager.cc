@@ -1,5 +1,5 @@
 #include "memorymanager.h"
-#include "machine.h"
+#include "system.h"
 
 
 //----------------------------------------------------------------------
@@ -9,76 +9,349 @@
 //  physical memory in the system. It does this in a synchronized
 //  fashion.
 //
-//  The memory manager uses a bitmap internally to keep track of the
-//  pages in the physical memory. Also, it does the synchronization
-//  using a lock and the memory manager is implemented like a monitor
-//  (synchronization primitive) whose methods different processes can
-//  use.
+//  The memory manager keeps a core map: an entry for each page of
+//  physical memory, counting the references to the page, since
+//  copy-on-write and the text cache let address spaces share pages,
+//  and listing the page table entries that map it, so that the pager
+//  can find the page table entry of a page it takes back.  The entry
+//  also says whether the page is pinned, and how recently it was
+//  used.  The free pages are kept on lists threaded through the core
+//  map, so allocating and freeing a page takes constant time.
+//
+//  There are two free lists: pages that may still hold what their last
+//  user left in them, and pages known to be all zeroes.  Pages for the
+//  uninitialized data and stack of a program must start out zeroed;
+//  rather than clear them as the program is loaded, they are taken
+//  from the pool of zeroed pages, which is refilled while the machine
+//  is idle.  Main memory starts out all zeroes, so every page starts
+//  in the pool.
+//
+//  Nor is the pool filled up front, which would touch the core map
+//  entry of every page, however large memory is: the core map starts
+//  out all zeroes too, and the pages from a high-water mark up, which
+//  have never been used, are free and zeroed without being on either
+//  list.  Only a page that has been freed goes on a list.
+//
+//  Also, it does the synchronization using a lock and the memory
+//  manager is implemented like a monitor (synchronization primitive)
+//  whose methods different processes can use.
 //----------------------------------------------------------------------
 
 MemoryManager::MemoryManager() {
 
     mmLock = new Semaphore("memory manager lock", 1);
-    bitmap = new BitMap(NumPhysPages);
+    coreMap = (CoreMapEntry *)
+        AllocLazyArray(machine->numPhysPages * sizeof(CoreMapEntry));
+    freeList = zeroList = -1;
+    nextUnused = 0;
+    unusedZeroed = true;
+    numFree = machine->numPhysPages;
 
 }
 
 //----------------------------------------------------------------------
 // MemoryManager::~MemoryManager
-//  Destructor. Delete the bitmap that was being used for tracking the
-//  pages.
+//  Destructor. Delete the core map that was being used for tracking
+//  the pages.
 //----------------------------------------------------------------------
 
 MemoryManager::~MemoryManager() {
 
-    delete bitmap;
+    for (int i = 0; i < nextUnused; i++)
+        while (coreMap[i].mappings != NULL) {
+            FrameMapping *mapping = coreMap[i].mappings;
+
+            coreMap[i].mappings = mapping->next;
+            delete mapping;
+        }
+    DeallocLazyArray((char *) coreMap,
+                     machine->numPhysPages * sizeof(CoreMapEntry));
     delete mmLock;
 
 }
 
+//----------------------------------------------------------------------
+// MemoryManager::PutFree, MemoryManager::TakeFree
+//  Put the page whose page number was given at the head of its free
+//  list -- the zeroed list if it is known to be all zeroes -- or take
+//  it off the list wherever it is on it.  Called with the lock held.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+void MemoryManager::PutFree(int which) {
+
+    int *list = coreMap[which].zeroed ? &zeroList : &freeList;
+
+    coreMap[which].prevFree = -1;
+    coreMap[which].nextFree = *list;
+    if (*list != -1)
+        coreMap[*list].prevFree = which;
+    *list = which;
+    numFree++;
+
+}
+
+int MemoryManager::TakeFree(int which) {
+
+    CoreMapEntry *entry = &coreMap[which];
+
+    if (entry->prevFree != -1)
+        coreMap[entry->prevFree].nextFree = entry->nextFree;
+    else if (entry->zeroed)
+        zeroList = entry->nextFree;
+    else
+        freeList = entry->nextFree;
+    if (entry->nextFree != -1)
+        coreMap[entry->nextFree].prevFree = entry->prevFree;
+    numFree--;
+    entry->refCount = 1;
+    entry->pinCount = 0;
+    entry->age = 0;
+    return which;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::TakeUnused
+//  Take the first page that has never been used, raising the
+//  high-water mark past it.  Its core map entry is still all zeroes.
+//  Called with the lock held, and at least one page never used.
+//
+//  Returns the page number
+//----------------------------------------------------------------------
+
+int MemoryManager::TakeUnused() {
+
+    ASSERT(nextUnused < machine->numPhysPages);
+    int which = nextUnused++;
+
+    numFree--;
+    coreMap[which].refCount = 1;
+    return which;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::PickFree
+//  Take a free page off one of the free lists, or one never used.  If
+//  the caller needs it zeroed, take one from the pool of zeroed pages,
+//  or clear one if the pool is empty; otherwise leave the pool for
+//  those who do.  Called with the lock held, and at least one page
+//  free.
+//
+//  "zeroed" is true if the page must be all zeroes
+//
+//  Returns the page number
+//----------------------------------------------------------------------
+
+int MemoryManager::PickFree(bool zeroed) {
+
+    int page_number;
+    bool clear = false;         // does it need clearing?
+
+    if (!zeroed && freeList != -1)
+        page_number = TakeFree(freeList);
+    else if (zeroList != -1)
+        page_number = TakeFree(zeroList);
+    else if (nextUnused < machine->numPhysPages) {
+        page_number = TakeUnused();
+        clear = !unusedZeroed;
+    } else {
+        page_number = TakeFree(freeList);
+        clear = true;
+    }
+    if (zeroed && clear) {
+        stats->numZeroMisses++;
+        bzero(&machine->mainMemory[page_number * PageSize], PageSize);
+    } else if (zeroed)
+        stats->numZeroHits++;
+    coreMap[page_number].zeroed = false;    // it's about to be used
+    return page_number;
+
+}
+
 //----------------------------------------------------------------------
 // MemoryManager::AllocatePage
 //  Allocate a single page to the address space of the process that
 //  is requesting the allocation.
 //
+//  The new owner is about to fill the page, so any instructions the
+//  machine predecoded from its previous contents are thrown away.
+//
+//  "zeroed" is true if the page must be all zeroes, e.g. for
+//  uninitialized data or stack
+//
 //  Returns the page number
 //----------------------------------------------------------------------
 
-int MemoryManager::AllocatePage() {
+int MemoryManager::AllocatePage(bool zeroed) {
 
     // allocate page in a synchronized fashion
     mmLock->P();
-    int page_number = bitmap->Find();
-    ASSERT(page_number != -1);  // TODO - don't use assert
+    ASSERT(numFree > 0);  // TODO - don't use assert
+    int page_number = PickFree(zeroed);
     mmLock->V();
 
+    machine->InvalidateDecodedPage(page_number);
+
     return page_number;
 
 }
 
+//----------------------------------------------------------------------
+// MemoryManager::AllocatePages
+//  Allocate "n" pages at once, for an address space being built:
+//  either all of them or, if there aren't that many free, none.
+//
+//  "pages" is where to put the page numbers
+//  "numZeroed" is how many of them, at the start of "pages", must be
+//  all zeroes
+//
+//  Returns true if the pages were allocated
+//----------------------------------------------------------------------
+
+bool MemoryManager::AllocatePages(int n, int *pages, int numZeroed) {
+
+    mmLock->P();
+    if ((unsigned int) n > numFree) {
+        mmLock->V();
+        return false;
+    }
+    for (int i = 0; i < n; i++)
+        pages[i] = PickFree(i < numZeroed);
+    mmLock->V();
+
+    for (int i = 0; i < n; i++)
+        machine->InvalidateDecodedPage(pages[i]);
+
+    return true;
+
+}
+
 //----------------------------------------------------------------------
 // MemoryManager::DeallocatePage
-//  Deallocate the single page whose page number was given.
+//  Deallocate the single page whose page number was given.  If other
+//  page table entries still map the page, it only loses a reference,
+//  and is cleared when the last one goes.
 //
 //  "which" is the page number
+//  "space" and "vpn" are the page table entry that no longer maps the
+//  page; NULL if the reference wasn't a mapping
 //
-//  Returns 0 if the page was cleared otherwise -1
+//  Returns 0 if the page was deallocated otherwise -1
 //----------------------------------------------------------------------
 
-int MemoryManager::DeallocatePage(int which) {
+int MemoryManager::DeallocatePage(int which, AddrSpace *space,
+                                  unsigned int vpn) {
 
     // trying to deallocate a page that was not allocated
-    if(bitmap->Test(which) == false) return -1;
+    if (coreMap[which].refCount == 0) return -1;
     else {
         // deallocate the page in a synchronized way
         mmLock->P();
-        bitmap->Clear(which);
+        CoreMapEntry *entry = &coreMap[which];
+        ASSERT(entry->refCount > 0);
+        for (FrameMapping **prev = &entry->mappings; *prev != NULL;
+             prev = &(*prev)->next)
+            if ((*prev)->space == space && (*prev)->vpn == vpn) {
+                FrameMapping *mapping = *prev;
+
+                *prev = mapping->next;
+                delete mapping;
+                break;
+            }
+        if (--entry->refCount == 0) {
+            ASSERT(entry->mappings == NULL && entry->pinCount == 0);
+            entry->zeroed = false;
+            PutFree(which);
+        }
         mmLock->V();
         return 0;
     }
 
 }
 
+//----------------------------------------------------------------------
+// MemoryManager::SharePage
+//  Add a reference to the allocated page whose page number was given,
+//  because one more page table entry (or the text cache) holds it.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+void MemoryManager::SharePage(int which) {
+
+    mmLock->P();
+    ASSERT(coreMap[which].refCount > 0);
+    coreMap[which].refCount++;
+    mmLock->V();
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::GetRefCount
+//  Return the number of references to the page whose page number was
+//  given; 0 if it is free.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+int MemoryManager::GetRefCount(int which) {
+
+    return coreMap[which].refCount;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::ClaimPage
+//  Allocate the particular page whose page number was given, or add a
+//  reference to it if it is already allocated (shared copy-on-write).
+//  Used when restoring a checkpoint, where the page tables being
+//  restored already say which pages their processes are in.  The
+//  pages never used below it go on the free lists.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+void MemoryManager::ClaimPage(int which) {
+
+    mmLock->P();
+    if (coreMap[which].refCount == 0) {
+        while (nextUnused < which) {
+            int page_number = TakeUnused();
+
+            coreMap[page_number].refCount = 0;
+            coreMap[page_number].zeroed = unusedZeroed;
+            PutFree(page_number);
+        }
+        if (which == nextUnused)
+            TakeUnused();
+        else
+            TakeFree(which);
+        coreMap[which].zeroed = false;
+    }
+    else
+        coreMap[which].refCount++;
+    mmLock->V();
+
+    machine->InvalidateDecodedPage(which);
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::PageInUse
+//  Return true if the page whose page number was given is allocated.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+bool MemoryManager::PageInUse(int which) {
+
+    return coreMap[which].refCount > 0;
+
+}
+
 //----------------------------------------------------------------------
 // MemoryManager::GetFreePageCount
 //  Return the number of free pages in the physical memory.
@@ -86,7 +359,160 @@ int MemoryManager::DeallocatePage(int which) {
 
 unsigned int MemoryManager::GetFreePageCount() {
 
-    return bitmap->NumClear();
+    return numFree;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::ZeroFreePages
+//  Clear every free page that may hold old contents, and move it to
+//  the pool of zeroed pages.  Called when the machine has nothing else
+//  to do, so that programs find their zeroed pages ready.
+//
+//  Returns the number of pages cleared
+//----------------------------------------------------------------------
+
+int MemoryManager::ZeroFreePages() {
+
+    int count = 0;
+
+    mmLock->P();
+    while (freeList != -1) {
+        int page_number = freeList;
+
+        TakeFree(page_number);
+        bzero(&machine->mainMemory[page_number * PageSize], PageSize);
+        coreMap[page_number].refCount = 0;
+        coreMap[page_number].zeroed = true;
+        PutFree(page_number);
+        count++;
+    }
+    mmLock->V();
+
+    return count;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::ForgetZeroedPages
+//  Main memory has been overwritten wholesale (by restoring a
+//  checkpoint): the free pages may hold anything now, so empty the
+//  pool of zeroed pages.  The pages never used are no longer known to
+//  be zeroed either; they are cleared when they are first used.
+//----------------------------------------------------------------------
+
+void MemoryManager::ForgetZeroedPages() {
+
+    mmLock->P();
+    while (zeroList != -1) {
+        int page_number = zeroList;
+
+        TakeFree(page_number);
+        coreMap[page_number].refCount = 0;
+        coreMap[page_number].zeroed = false;
+        PutFree(page_number);
+    }
+    unusedZeroed = false;
+    mmLock->V();
+
+}
+
+
+//----------------------------------------------------------------------
+// MemoryManager::AddMapping
+//  Record that the page whose page number was given is mapped by
+//  virtual page "vpn" of "space".  The page table entry must already
+//  hold a reference to the page.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+void MemoryManager::AddMapping(int which, AddrSpace *space,
+                               unsigned int vpn) {
+
+    FrameMapping *mapping = new FrameMapping;
+
+    mapping->space = space;
+    mapping->vpn = vpn;
+    mmLock->P();
+    ASSERT(coreMap[which].refCount > 0);
+    mapping->next = coreMap[which].mappings;
+    coreMap[which].mappings = mapping;
+    mmLock->V();
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::GetMappings
+//  Return the list of page table entries mapping the page whose page
+//  number was given; NULL if none do.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+FrameMapping *MemoryManager::GetMappings(int which) {
+
+    return coreMap[which].mappings;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::PinPage, MemoryManager::UnpinPage
+//  Keep the page whose page number was given where it is, so that the
+//  pager doesn't take it back, e.g. while the kernel is copying to or
+//  from it; or let it go again.  Pins nest.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+void MemoryManager::PinPage(int which) {
+
+    mmLock->P();
+    ASSERT(coreMap[which].refCount > 0);
+    coreMap[which].pinCount++;
+    mmLock->V();
 
 }
 
+void MemoryManager::UnpinPage(int which) {
+
+    mmLock->P();
+    ASSERT(coreMap[which].pinCount > 0);
+    coreMap[which].pinCount--;
+    mmLock->V();
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::IsPinned
+//  Return true if the page whose page number was given can't be taken
+//  back right now.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+bool MemoryManager::IsPinned(int which) {
+
+    return coreMap[which].pinCount > 0;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::GetAge, MemoryManager::SetAge
+//  Return, or set, the recent use bits of the page whose page number
+//  was given, as kept by LRU replacement.
+//
+//  "which" is the page number
+//----------------------------------------------------------------------
+
+unsigned char MemoryManager::GetAge(int which) {
+
+    return coreMap[which].age;
+
+}
+
+void MemoryManager::SetAge(int which, unsigned char age) {
+
+    coreMap[which].age = age;
+
+}
@@ -1,24 +1,87 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
-#include "bitmap.h"
 #include "synch.h"
 
+class AddrSpace;
+
+// One page table entry mapping a physical page: virtual page "vpn" of
+// "space".
+
+class FrameMapping {
+
+    public:
+        AddrSpace *space;
+        unsigned int vpn;
+        FrameMapping *next;     // the next one mapping the same page
+};
+
+// The core map has one entry for each physical page, saying who is
+// using it and how.  An entry that is all zeroes is a free page.
+
+class CoreMapEntry {
+
+    public:
+        int refCount;           // number of references to the page: page
+                                // table entries mapping it, and the text
+                                // cache; 0 if it is free
+        FrameMapping *mappings; // the page table entries mapping it
+        int pinCount;           // number of reasons it can't be taken
+                                // back right now
+        unsigned char age;      // recent use bits, the latest in the
+                                // high bit, for LRU replacement
+        bool zeroed;            // if free, is it known to be all zeroes?
+        int prevFree, nextFree; // neighbours on its free list, if free
+};
+
 class MemoryManager {
 
     public:
         MemoryManager();
         ~MemoryManager();
 
-        int AllocatePage();
-        int DeallocatePage(int which);
+        int AllocatePage(bool zeroed = false);
+        bool AllocatePages(int n, int *pages, int numZeroed = 0);
+        int DeallocatePage(int which, AddrSpace *space = NULL,
+                           unsigned int vpn = 0);
+        void SharePage(int which);
+        int GetRefCount(int which);
+        void ClaimPage(int which);
+        bool PageInUse(int which);
         unsigned int GetFreePageCount();
+        int ZeroFreePages();
+        void ForgetZeroedPages();
+
+        void AddMapping(int which, AddrSpace *space, unsigned int vpn);
+        FrameMapping *GetMappings(int which);
+
+        void PinPage(int which);
+        void UnpinPage(int which);
+        bool IsPinned(int which);
+
+        unsigned char GetAge(int which);
+        void SetAge(int which, unsigned char age);
 
     private:
-        BitMap *bitmap;
+        int TakeFree(int which);        // Take "which" off its free list
+        void PutFree(int which);        // and put it back
+        int TakeUnused();               // Take the first page never used
+        int PickFree(bool zeroed);      // Take a free page, zeroing it
+                                        // if need be
+
+        CoreMapEntry *coreMap;  // one entry for each physical page
+        int freeList;           // the first free page that may hold
+                                // old contents, -1 if none
+        int zeroList;           // the first free page known to be all
+                                // zeroes, -1 if none
+        int nextUnused;         // the pages from here up have never
+                                // been used: free, but on neither list
+        bool unusedZeroed;      // are those known to be all zeroes?
+        unsigned int numFree;   // number of free pages, on both lists
+                                // and never used
         Semaphore *mmLock;
 };
 
 
 
-#endif // MEMORY_H
\ No newline at end of file
+#endif // MEMORY_H
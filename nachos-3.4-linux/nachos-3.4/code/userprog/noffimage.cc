@@ -0,0 +1,202 @@
+// noffimage.cc
+//	Routines to parse an executable file in Nachos object code format,
+//	and to read its code and data a page at a time.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "noffimage.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SwapHeader
+// 	Do little endian to big endian conversion on the bytes in the
+//	object file header, in case the file was generated on a little
+//	endian machine, and we're now running on a big endian machine.
+//----------------------------------------------------------------------
+
+static void SwapHeader(NoffHeader *noffH)
+{
+    noffH->noffMagic = WordToHost(noffH->noffMagic);
+    noffH->code.size = WordToHost(noffH->code.size);
+    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
+    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
+    noffH->initData.size = WordToHost(noffH->initData.size);
+    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
+    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
+    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
+    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
+    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+}
+
+//----------------------------------------------------------------------
+// NoffImage::NoffImage
+// 	Read and check the header of the executable "file".  The image
+//	starts out with one reference, for the address space creating it.
+//
+//	"file" is the open executable; it is closed with the image
+//	"fileName" is its name
+//----------------------------------------------------------------------
+
+NoffImage::NoffImage(OpenFile *file, const char *fileName)
+{
+    executable = file;
+    contents = NULL;
+    length = executable->Length();
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    refCount = 1;
+
+    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
+    if ((noffH.noffMagic != NOFFMAGIC) &&
+        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
+        SwapHeader(&noffH);
+    valid = (noffH.noffMagic == NOFFMAGIC);
+}
+
+//----------------------------------------------------------------------
+// NoffImage::~NoffImage
+// 	Close the executable.
+//----------------------------------------------------------------------
+
+NoffImage::~NoffImage()
+{
+    delete executable;
+    delete [] contents;
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// NoffImage::Hold, NoffImage::Release
+// 	Count the address spaces running the image; the last one to
+//	let go of it deletes it.
+//----------------------------------------------------------------------
+
+void NoffImage::Hold()
+{
+    refCount++;
+}
+
+void NoffImage::Release()
+{
+    ASSERT(refCount > 0);
+    if (--refCount == 0)
+        delete this;
+}
+
+//----------------------------------------------------------------------
+// NoffImage::GetSize
+// 	Return the number of bytes the program's code and data take up,
+//	not counting its stack.
+//----------------------------------------------------------------------
+
+unsigned int NoffImage::GetSize()
+{
+    return noffH.code.size + noffH.initData.size + noffH.uninitData.size;
+}
+
+//----------------------------------------------------------------------
+// NoffImage::GetLength
+// 	Return the length of the executable file.  Together with its name,
+//	this tells apart two executables closely enough to share their
+//	code.
+//----------------------------------------------------------------------
+
+int NoffImage::GetLength()
+{
+    return length;
+}
+
+//----------------------------------------------------------------------
+// NoffImage::IsTextPage
+// 	Return TRUE if virtual page "vpn" holds code and nothing else, so
+//	that it never changes while the program runs, and one copy of it
+//	can be shared by every address space running the program.
+//----------------------------------------------------------------------
+
+bool NoffImage::IsTextPage(unsigned int vpn)
+{
+    return Overlaps(&noffH.code, vpn) && !Overlaps(&noffH.initData, vpn) &&
+           !Overlaps(&noffH.uninitData, vpn);
+}
+
+//----------------------------------------------------------------------
+// NoffImage::IsZeroPage
+// 	Return TRUE if virtual page "vpn" holds nothing from the file --
+//	only uninitialized data, or stack -- so that it starts out all
+//	zeroes, and any page of zeroes will do for it.
+//----------------------------------------------------------------------
+
+bool NoffImage::IsZeroPage(unsigned int vpn)
+{
+    return !Overlaps(&noffH.code, vpn) && !Overlaps(&noffH.initData, vpn);
+}
+
+//----------------------------------------------------------------------
+// NoffImage::Overlaps
+// 	Return TRUE if any of "segment" falls in virtual page "vpn".
+//----------------------------------------------------------------------
+
+bool NoffImage::Overlaps(Segment *segment, unsigned int vpn)
+{
+    unsigned int pageStart = vpn * PageSize;
+
+    return segment->size > 0 &&
+           (unsigned)(segment->virtualAddr + segment->size) > pageStart &&
+           (unsigned)segment->virtualAddr < pageStart + PageSize;
+}
+
+//----------------------------------------------------------------------
+// NoffImage::ReadPage
+// 	Fill "into", a page of memory, with the contents virtual page "vpn"
+//	has when the program starts: the parts of the code and initialized
+//	data segments that fall in the page, and zeroes everywhere else
+//	(uninitialized data and stack).
+//
+//	The file is read in whole the first time; the segments are copied
+//	from there.
+//----------------------------------------------------------------------
+
+void NoffImage::ReadPage(unsigned int vpn, char *into)
+{
+    if (contents == NULL)
+    {
+        DEBUG('a', "Reading in %s, %d bytes\n", name, length);
+        contents = new char[length];
+        executable->ReadAt(contents, length, 0);
+    }
+    bzero(into, PageSize);
+    ReadSegment(&noffH.code, vpn, into);
+    ReadSegment(&noffH.initData, vpn, into);
+}
+
+//----------------------------------------------------------------------
+// NoffImage::ReadSegment
+// 	Copy the part of "segment" that falls in virtual page "vpn", if
+//	any, into the same place in "into".  Bytes the segment claims
+//	beyond the end of the file are left zero.
+//----------------------------------------------------------------------
+
+void NoffImage::ReadSegment(Segment *segment, unsigned int vpn, char *into)
+{
+    unsigned int pageStart = vpn * PageSize;
+    unsigned int start = segment->virtualAddr;
+    unsigned int end = segment->virtualAddr + segment->size;
+
+    if (!Overlaps(segment, vpn))
+        return;
+    if (start < pageStart)
+        start = pageStart;
+    if (end > pageStart + PageSize)
+        end = pageStart + PageSize;
+
+    int offset = segment->inFileAddr + (start - segment->virtualAddr);
+    int count = end - start;
+    if (offset < 0 || offset >= length)
+        return;
+    if (offset + count > length)
+        count = length - offset;
+    bcopy(contents + offset, into + (start - pageStart), count);
+}
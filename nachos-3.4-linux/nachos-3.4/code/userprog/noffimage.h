@@ -0,0 +1,63 @@
+// noffimage.h
+//	Data structures for an executable file in Nachos object code format
+//	(NOFF), opened to be run by one or more address spaces.
+//
+//	A NoffImage owns the open file and the parsed header.  Address
+//	spaces running the program hold a reference to it, so that the
+//	pages of the program can be read in whenever they are needed, not
+//	just when the program is started.
+//
+//	The first time a page is read, the whole file is read into host
+//	memory, with one read; every page after that is filled by copying
+//	whole runs of bytes out of that copy.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef NOFFIMAGE_H
+#define NOFFIMAGE_H
+
+#include "copyright.h"
+#include "filesys.h"
+#include "noff.h"
+
+class NoffImage {
+  public:
+    NoffImage(OpenFile *file, const char *fileName);
+					// Parse the header of "file", which
+					// the image now owns
+    ~NoffImage();			// Close the file
+
+    bool IsValid() { return valid; }	// Is it really a NOFF file?
+    const char *GetName() { return name; }
+
+    void Hold();			// One more address space runs it
+    void Release();			// One less; delete the image
+					// when there are none left
+
+    unsigned int GetSize();		// Bytes of code and data (both
+					// initialized and not)
+    int GetLength();			// Bytes in the executable file
+    bool IsTextPage(unsigned int vpn);	// Does page "vpn" hold only code?
+    bool IsZeroPage(unsigned int vpn);	// Does it start out all zeroes?
+    void ReadPage(unsigned int vpn, char *into);
+					// Fill "into" with what the program
+					// starts with in virtual page "vpn"
+
+    NoffHeader noffH;			// the header, in host byte order
+    OpenFile *executable;		// the file itself
+
+  private:
+    bool Overlaps(Segment *segment, unsigned int vpn);
+    void ReadSegment(Segment *segment, unsigned int vpn, char *into);
+
+    char *contents;			// the whole file, NULL until the
+					// first page is read
+    int length;				// # of bytes in it
+    char *name;				// the file's name
+    bool valid;				// did the magic number match?
+    int refCount;			// # of address spaces running it
+};
+
+#endif // NOFFIMAGE_H
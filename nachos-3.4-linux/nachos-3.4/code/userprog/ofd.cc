@@ -50,11 +50,11 @@ OFD::OFD(const char *fileName, int id)
 // OFD::~OFD
 //  Destructor.
 //
-//  Disassociate a VNode.
+//  Disassociate a VNode, unless it isn't the vnode manager's.
 //------------------------------------------------------------------------
 OFD::~OFD()
 {
-    vnm->RelieveVNode(fileVNode);
+    if(fileVNode != NULL) vnm->RelieveVNode(fileVNode);
     delete syncLock;
 }
 
@@ -110,6 +110,55 @@ const char *OFD::GetName()
     return name;
 }
 
+//------------------------------------------------------------------------
+// OFD::GetOffset
+//  Return the file offset in bytes.
+//------------------------------------------------------------------------
+unsigned int OFD::GetOffset()
+{
+    return fileOffSet;
+}
+
+//------------------------------------------------------------------------
+// OFD::SetOffset
+//  Move the file offset to the given byte.
+//
+//  "offset" is the new file offset in bytes
+//------------------------------------------------------------------------
+void OFD::SetOffset(unsigned int offset)
+{
+    syncLock->P();
+    fileOffSet = offset;
+    syncLock->V();
+}
+
+//------------------------------------------------------------------------
+// OFD::IsConsole
+//  Return whether the OFD is a connection to the console.
+//------------------------------------------------------------------------
+bool OFD::IsConsole()
+{
+    return false;
+}
+
+//------------------------------------------------------------------------
+// OFD::IsPipe
+//  Return whether the OFD is one end of a pipe.
+//------------------------------------------------------------------------
+bool OFD::IsPipe()
+{
+    return false;
+}
+
+//------------------------------------------------------------------------
+// OFD::GetVNode
+//  Return the VNode of the file the OFD is a connection to.
+//------------------------------------------------------------------------
+VNode *OFD::GetVNode()
+{
+    return fileVNode;
+}
+
 //------------------------------------------------------------------------
 // OFD::Read
 //  Read from the file into the given buffer.
@@ -170,6 +219,15 @@ ConsoleOFD::ConsoleOFD(const char *fileName, int id) : OFD(id)
     syncLock = new Semaphore(lockName, 1);
 }
 
+//------------------------------------------------------------------------
+// ConsoleOFD::IsConsole
+//  Return whether the OFD is a connection to the console.
+//------------------------------------------------------------------------
+bool ConsoleOFD::IsConsole()
+{
+    return true;
+}
+
 //------------------------------------------------------------------------
 // ConsoleOFD::Read
 //  Read from the console into the given buffer.
@@ -209,3 +267,83 @@ int ConsoleOFD::Write(unsigned int virtAddr, unsigned int nBytes)
     syncLock->V();
     return bytesWritten;
 }
+
+//------------------------------------------------------------------------
+// PipeOFD::PipeOFD
+//  Constructor
+//
+//  "pipe" is the pipe the OFD is one end of.
+//  "isWriteEnd" is whether it is the end written to.
+//  "id" is the index of the OFD in the Open File Table.
+//------------------------------------------------------------------------
+PipeOFD::PipeOFD(PipeVNode *pipe, bool isWriteEnd, int id) : OFD(id)
+{
+    name = isWriteEnd ? "Pipe (write end)" : "Pipe (read end)";
+    fileVNode = pipe;
+    writeEnd = isWriteEnd;
+
+    char lockName[100];
+    snprintf(lockName, sizeof(lockName), "ofd-%d sync lock", id);
+    syncLock = new Semaphore(lockName, 1);
+}
+
+//------------------------------------------------------------------------
+// PipeOFD::~PipeOFD
+//  Destructor.
+//
+//  Close our end of the pipe; whoever closes the second end deletes it.
+//------------------------------------------------------------------------
+PipeOFD::~PipeOFD()
+{
+    PipeVNode *pipe = (PipeVNode *) fileVNode;
+
+    fileVNode = NULL;  // not the vnode manager's
+    if(pipe->CloseEnd(writeEnd)) delete pipe;
+}
+
+//------------------------------------------------------------------------
+// PipeOFD::IsPipe
+//  Return whether the OFD is one end of a pipe.
+//------------------------------------------------------------------------
+bool PipeOFD::IsPipe()
+{
+    return true;
+}
+
+//------------------------------------------------------------------------
+// PipeOFD::Read
+//  Read from the pipe into the given buffer, waiting for something to
+//  read if need be.
+//
+//  A pipe has no offset, so the OFD isn't locked: the pipe does its own
+//  locking, and a reader waiting on an empty pipe mustn't hold up the
+//  processes sharing the OFD.
+//
+//  "virtAddr" is the virtual address of the start of the buffer
+//  "nBytes" is the number of bytes to read
+//
+//  Returns the number of bytes read (0 at the end of the data), or -1
+//  on the end written to
+//------------------------------------------------------------------------
+int PipeOFD::Read(unsigned int virtAddr, unsigned int nBytes)
+{
+    if(writeEnd) return -1;
+    return fileVNode->ReadAt(virtAddr, nBytes, 0);
+}
+
+//------------------------------------------------------------------------
+// PipeOFD::Write
+//  Write from the given buffer into the pipe, waiting for room if need
+//  be.  No OFD lock, as for Read.
+//
+//  "virtAddr" is the virtual address of the start of the buffer
+//  "nBytes" is the number of bytes to write
+//
+//  Returns the number of bytes written, or -1 if the end read from is
+//  closed, or this is the end read from
+//------------------------------------------------------------------------
+int PipeOFD::Write(unsigned int virtAddr, unsigned int nBytes)
+{
+    if(!writeEnd) return -1;
+    return fileVNode->WriteAt(virtAddr, nBytes, 0);
+}
@@ -35,6 +35,11 @@ class OFD
         void DecreaseRef();
         bool IsActive();
         const char *GetName();
+        unsigned int GetOffset();
+        void SetOffset(unsigned int offset);
+        virtual bool IsConsole();
+        virtual bool IsPipe();
+        VNode *GetVNode();
 
         virtual int Read(unsigned int virtAddr, unsigned int nBytes);
         virtual int Write(unsigned int virtAddr, unsigned int nBytes);
@@ -56,8 +61,25 @@ class ConsoleOFD : public OFD
     public:
         ConsoleOFD(const char *fileName, int id);
 
+        virtual bool IsConsole();
+
         virtual int Read(unsigned int virtAddr, unsigned int nBytes);
         virtual int Write(unsigned int virtAddr, unsigned int nBytes);
 };
 
+class PipeOFD : public OFD
+{
+    public:
+        PipeOFD(PipeVNode *pipe, bool isWriteEnd, int id);
+        virtual ~PipeOFD();
+
+        virtual bool IsPipe();
+
+        virtual int Read(unsigned int virtAddr, unsigned int nBytes);
+        virtual int Write(unsigned int virtAddr, unsigned int nBytes);
+
+    private:
+        bool writeEnd;  // is this the end written to, or the end read from?
+};
+
 #endif  // OFD_H
@@ -65,6 +65,38 @@ OFD *OpenFileTable::AllocateOFD(const char *fileName, bool consoleOFD)
     }
 }
 
+//------------------------------------------------------------------------
+// OpenFileTable::AllocatePipe
+//  Create a pipe, and allocate an open file descriptor for each of its
+//  ends to the invoking process.
+//
+//  "readEnd" is set to the OFD of the end read from.
+//  "writeEnd" is set to the OFD of the end written to.
+//
+//  Returns false if the table doesn't have room for both.
+//------------------------------------------------------------------------
+bool OpenFileTable::AllocatePipe(OFD **readEnd, OFD **writeEnd)
+{
+    oftLock->P();
+
+    int readID = bitmap->Find();
+    int writeID = bitmap->Find();
+    if (writeID == -1)
+    {
+        // no free entry in the table for both ends
+        if (readID != -1) bitmap->Clear(readID);
+        oftLock->V();
+        return false;
+    }
+
+    PipeVNode *pipe = new PipeVNode();
+    entries[readID] = *readEnd = new PipeOFD(pipe, false, readID);
+    entries[writeID] = *writeEnd = new PipeOFD(pipe, true, writeID);
+
+    oftLock->V();
+    return true;
+}
+
 //------------------------------------------------------------------------
 // OpenFileTable::DeallocateOFD
 //  Delete the allocated given open file descriptor if unused.
@@ -20,6 +20,7 @@ class OpenFileTable
 
         OFD *AllocateOFD(const char *fileName, bool consoleOFD = false);
         void DeallocateOFD(OFD *ofd);
+        bool AllocatePipe(OFD **readEnd, OFD **writeEnd);
 
     private:
         BitMap *bitmap;  // bitmap to indicate if an entry is already filled
@@ -17,6 +17,7 @@ PCB::PCB(int id)
         parent = currentThread->space->pcb;
     children = new List();
     exitStatus = -9999; // hasn't exited
+    killed = false;
 
     bitmap = new BitMap(MAX_PROC_OFDS);
     ofds = new OFD*[MAX_PROC_OFDS];
@@ -28,9 +29,17 @@ PCB::PCB(int id)
     ofds[1] = oft->AllocateOFD("STDOUT", true);
     bitmap->Mark(1);
 
+    // the other files the parent has open are inherited, sharing their
+    // offsets, so that a parent and child can talk through a pipe
     for(int i = 2; i < MAX_PROC_OFDS; i++)
     {
         ofds[i] = NULL;
+        if(parent != NULL && parent->ofds[i] != NULL)
+        {
+            ofds[i] = parent->ofds[i];
+            ofds[i]->IncreaseRef();
+            bitmap->Mark(i);
+        }
     }
 }
 
@@ -131,7 +140,7 @@ void PCB::DeleteExitedChildrenSetParentNull()
     while (child != NULL)
     {
         if (child->HasExited())
-            delete child;
+            pcbManager->DeallocatePCB(child);
         else
             child->SetParent(NULL);
         child = (PCB *)children->Remove();
@@ -168,6 +177,71 @@ void PCB::DeallocateFD(int fid)
     ofds[fid] = NULL;
 }
 
+//----------------------------------------------------------------------
+// PCB::AllocatePipe
+//  Create a pipe, and allocate a file descriptor for each of its ends
+//
+//  "readFid" is set to the file descriptor of the end read from
+//  "writeFid" is set to the file descriptor of the end written to
+//
+//  Returns false if there are no file descriptors left for both
+//----------------------------------------------------------------------
+bool PCB::AllocatePipe(int *readFid, int *writeFid)
+{
+    OFD *readEnd, *writeEnd;
+
+    *readFid = bitmap->Find();
+    *writeFid = bitmap->Find();
+    if(*writeFid == -1 || !oft->AllocatePipe(&readEnd, &writeEnd))
+    {
+        if(*readFid != -1) bitmap->Clear(*readFid);
+        if(*writeFid != -1) bitmap->Clear(*writeFid);
+        return false;
+    }
+    ofds[*readFid] = readEnd;
+    ofds[*writeFid] = writeEnd;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// PCB::CloseFiles
+//  Close every file the process has open, when it exits.  So the other
+//  end of a pipe sees it go.  The console stays, as the PCB started out.
+//----------------------------------------------------------------------
+void PCB::CloseFiles()
+{
+    for(int fid = 2; fid < MAX_PROC_OFDS; fid++)
+    {
+        if(ofds[fid] != NULL) DeallocateFD(fid);
+    }
+}
+
+//----------------------------------------------------------------------
+// PCB::Kill
+//  Mark the process killed, when it is blocked in the kernel and can't
+//  just be taken off the ready list and deleted.  Anyone waiting on one
+//  of its pipes is woken up, so that if it is the process, it gives up
+//  waiting; it then exits on its way back to user mode.
+//----------------------------------------------------------------------
+void PCB::Kill()
+{
+    killed = true;
+    for(int fid = 2; fid < MAX_PROC_OFDS; fid++)
+    {
+        if(ofds[fid] != NULL && ofds[fid]->IsPipe())
+            ((PipeVNode *) ofds[fid]->GetVNode())->Wake();
+    }
+}
+
+//----------------------------------------------------------------------
+// PCB::IsKilled
+//  Return whether the process has been killed, and should exit.
+//----------------------------------------------------------------------
+bool PCB::IsKilled()
+{
+    return killed;
+}
+
 //----------------------------------------------------------------------
 // PCB::GetOFD
 //  Get the  (file id)
@@ -177,3 +251,23 @@ OFD *PCB::GetOFD(int fid)
     if(fid < 0) return NULL;
     return ofds[fid];
 }
+
+//----------------------------------------------------------------------
+// PCB::AllocateFD
+//  Open the file under the given file descriptor (file id), which must
+//  be free.  Used when restoring a checkpoint, where each process must
+//  get its files back under the same file ids.
+//
+//  "fid" is the file descriptor wanted
+//  "fileName" is the name of the file
+//
+//  Returns true if the file could be opened
+//----------------------------------------------------------------------
+bool PCB::AllocateFD(int fid, const char *fileName)
+{
+    ASSERT(!bitmap->Test(fid));
+    ofds[fid] = oft->AllocateOFD(fileName);
+    if(ofds[fid] == NULL) return false;
+    bitmap->Mark(fid);
+    return true;
+}
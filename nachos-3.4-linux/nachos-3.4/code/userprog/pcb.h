@@ -27,10 +27,17 @@ public:
     int AllocateFD(char *fileName);
     void DeallocateFD(int fid);
     OFD *GetOFD(int fid);
+    bool AllocateFD(int fid, const char *fileName);
+    bool AllocatePipe(int *readFid, int *writeFid);
+    void CloseFiles();
+
+    void Kill();  // kill the process while it is blocked in the kernel
+    bool IsKilled();
 
 private:
     int pid;
     PCB *parent;
+    bool killed;  // the process exits as soon as it can
     List *children;
 
     BitMap *bitmap;  // marks the FDs already taken
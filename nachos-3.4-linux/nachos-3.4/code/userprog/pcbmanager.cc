@@ -63,6 +63,28 @@ PCB *PCBManager::AllocatePCB()
     }
 }
 
+//--------------------------------------------------------------------
+// PCBManager::AllocatePCB
+//  Allocate the pcb with the given pid.  Used when restoring a
+//  checkpoint, where processes must get back the pids they had.
+//
+//  "pid" is the pid wanted; it must be free
+//
+//  Returns a pointer to the allocated pcb
+//--------------------------------------------------------------------
+
+PCB *PCBManager::AllocatePCB(int pid)
+{
+    pcbManagerLock->P();
+
+    ASSERT(!bitmap->Test(pid));
+    bitmap->Mark(pid);
+    pcbs[pid] = new PCB(pid);
+
+    pcbManagerLock->V();
+    return pcbs[pid];
+}
+
 //--------------------------------------------------------------------
 // PCBManager::DeallocatePCB
 //  Deallocate (delete) the pcb instance and clean up after it
@@ -12,6 +12,7 @@ class PCBManager {
         ~PCBManager();
 
         PCB* AllocatePCB();
+        PCB* AllocatePCB(int pid);
         void DeallocatePCB(PCB* pcb);
         PCB* GetPCB(int pid);
 
@@ -23,7 +23,7 @@
 void
 StartProcess(char *filename)
 {
-    OpenFile *executable = fileSystem->Open(filename);
+    NoffImage *executable = imageCache->Open(filename);
     AddrSpace *space;
 
     if (executable == NULL) {
@@ -35,8 +35,8 @@ StartProcess(char *filename)
     currentThread->space = space;
     currentThread->space->pcb = pcbManager->AllocatePCB();
     ASSERT(currentThread->space->pcb != NULL);
-
-    delete executable;			// close file
+    if (profiler != NULL)
+        space->profile = profiler->FindImage(filename);
 
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
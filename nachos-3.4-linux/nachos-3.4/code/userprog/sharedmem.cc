@@ -0,0 +1,186 @@
+// sharedmem.cc
+//	Routines to create, attach and free segments of memory shared
+//	between user programs.
+//
+//	Mapping a segment into an address space is up to the address space
+//	(see AddrSpace::AttachSegment); the table only keeps the segments,
+//	and counts their users.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "sharedmem.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SharedSegment::SharedSegment
+// 	Start a segment called "segmentName", of "size" pages, with no
+//	physical pages or users yet.
+//----------------------------------------------------------------------
+
+SharedSegment::SharedSegment(const char *segmentName, unsigned int size)
+{
+    name = new char[strlen(segmentName) + 1];
+    strcpy(name, segmentName);
+    numPages = size;
+    frames = new int[numPages];
+    users = 0;
+    next = NULL;
+}
+
+SharedSegment::~SharedSegment()
+{
+    delete [] name;
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// SegmentTable::SegmentTable
+// 	Start with no segments.
+//----------------------------------------------------------------------
+
+SegmentTable::SegmentTable()
+{
+    segments = NULL;
+    lock = new Semaphore("segment table lock", 1);
+}
+
+//----------------------------------------------------------------------
+// SegmentTable::~SegmentTable
+// 	Forget every segment; their pages go with physical memory.
+//----------------------------------------------------------------------
+
+SegmentTable::~SegmentTable()
+{
+    while (segments != NULL) {
+        SharedSegment *segment = segments;
+
+        segments = segment->next;
+        delete segment;
+    }
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// SegmentTable::Create
+// 	Make a new segment called "name", of "size" bytes rounded up to
+//	whole pages, all zeroes.  With virtual memory, pages are taken
+//	back from other address spaces if need be.  The creator is the
+//	segment's first user, and lets go of it with Detach like the
+//	others, so that a segment nobody attaches doesn't outlive it.
+//
+//	Returns NULL if there is a segment called "name" already, or
+//	there isn't memory for it.
+//----------------------------------------------------------------------
+
+SharedSegment *
+SegmentTable::Create(const char *name, int size)
+{
+    SharedSegment *segment;
+    unsigned int numPages = divRoundUp(size, PageSize);
+
+    if (size <= 0)
+        return NULL;
+    lock->P();
+    for (segment = segments; segment != NULL; segment = segment->next)
+        if (!strcmp(segment->name, name)) {
+            lock->V();
+            return NULL;
+        }
+
+    segment = new SharedSegment(name, numPages);
+#ifdef VM
+    unsigned int i;
+
+    for (i = 0; i < numPages; i++) {
+        segment->frames[i] = pager->AllocateFrame(TRUE);
+        if (segment->frames[i] == -1)
+            break;
+    }
+    if (i < numPages) {
+        while (i > 0)
+            mm->DeallocatePage(segment->frames[--i]);
+        delete segment;
+        lock->V();
+        return NULL;
+    }
+#else
+    if (!mm->AllocatePages(numPages, segment->frames, numPages)) {
+        delete segment;
+        lock->V();
+        return NULL;
+    }
+#endif
+    DEBUG('a', "Shared segment %s: %d pages\n", name, numPages);
+    segment->users = 1;
+    segment->next = segments;
+    segments = segment;
+    lock->V();
+    return segment;
+}
+
+//----------------------------------------------------------------------
+// SegmentTable::Attach
+// 	Return the segment called "name", and count one more user;
+//	NULL if there is no such segment.
+//----------------------------------------------------------------------
+
+SharedSegment *
+SegmentTable::Attach(const char *name)
+{
+    SharedSegment *segment;
+
+    lock->P();
+    for (segment = segments; segment != NULL; segment = segment->next)
+        if (!strcmp(segment->name, name))
+            break;
+    if (segment != NULL)
+        segment->users++;
+    lock->V();
+    return segment;
+}
+
+//----------------------------------------------------------------------
+// SegmentTable::Hold
+// 	Count one more user of "segment": an address space forked from
+//	one that has it attached.
+//----------------------------------------------------------------------
+
+void
+SegmentTable::Hold(SharedSegment *segment)
+{
+    lock->P();
+    segment->users++;
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// SegmentTable::Detach
+// 	Count one less user of "segment".  When there are none left, give
+//	back the segment's references to its pages -- freeing them, since
+//	no address space maps them any more -- and forget its name.
+//----------------------------------------------------------------------
+
+void
+SegmentTable::Detach(SharedSegment *segment)
+{
+    lock->P();
+    ASSERT(segment->users > 0);
+    if (--segment->users > 0) {
+        lock->V();
+        return;
+    }
+
+    SharedSegment **prev = &segments;
+    while (*prev != segment)
+        prev = &(*prev)->next;
+    *prev = segment->next;
+    lock->V();
+
+    DEBUG('a', "Shared segment %s: freed\n", segment->name);
+    for (unsigned int i = 0; i < segment->numPages; i++)
+        mm->DeallocatePage(segment->frames[i]);
+    delete segment;
+}
@@ -0,0 +1,70 @@
+// sharedmem.h
+//	Data structures for memory shared between user programs.
+//
+//	A shared segment is a named run of physical pages that any number
+//	of address spaces can map, each at an address of its own choosing,
+//	so that what one process stores there the others can load straight
+//	away -- no system call, and no copy by the kernel, per transfer.
+//
+//	A segment is created, zeroed, with a name and a size, and attached
+//	by name; a process forked from one with a segment attached has it
+//	attached too.  The segment holds a reference to each of its pages,
+//	and each address space mapping it one more, so the pager never
+//	takes them back.  The address space that created the segment
+//	counts as a user until it goes away, whether or not it attaches
+//	the segment, so a segment nobody attaches is freed too.  When the
+//	last user lets go, the pages are freed and the name is forgotten.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SHAREDMEM_H
+#define SHAREDMEM_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define MaxSegmentNameLength	32	// longest segment name, not
+					// counting the null
+
+// One shared segment.
+
+class SharedSegment {
+  public:
+    SharedSegment(const char *segmentName, unsigned int size);
+    ~SharedSegment();
+
+    char *name;				// what it is attached by
+    unsigned int numPages;		// its size
+    int *frames;			// the physical page holding each of
+					// its pages
+    int users;				// # of address spaces attaching
+					// it, and its creator
+    SharedSegment *next;		// the next segment in the table
+};
+
+class SegmentTable {
+  public:
+    SegmentTable();
+    ~SegmentTable();
+
+    SharedSegment *Create(const char *name, int size);
+					// Make a new segment of "size"
+					// bytes, with its creator as its
+					// user; NULL if the name is taken
+					// or there is no memory for it
+    SharedSegment *Attach(const char *name);
+					// Return the segment "name", for one
+					// more address space; NULL if none
+    void Hold(SharedSegment *segment);	// One more address space has it
+    void Detach(SharedSegment *segment);
+					// One less; free it when there are
+					// none left
+
+  private:
+    SharedSegment *segments;		// every segment
+    Semaphore *lock;			// one change to the table at a time
+};
+
+#endif // SHAREDMEM_H
@@ -30,6 +30,14 @@
 #define SC_Fork		9
 #define SC_Yield	10
 #define SC_Kill     11
+#define SC_Checkpoint	12
+#define SC_Sbrk		13
+#define SC_ShmCreate	14
+#define SC_ShmAttach	15
+#define SC_ShmDetach	16
+#define SC_Mmap		17
+#define SC_Munmap	18
+#define SC_Pipe		19
 
 #ifndef IN_ASM
 
@@ -73,6 +81,11 @@ int Join(SpaceId id);
  * If this assignment is done before doing the file system assignment,
  * note that the Nachos file system has a stub implementation, which
  * will work for the purposes of testing out these routines.
+ *
+ * The names and buffers passed to any system call must be in the caller's
+ * address space, and names at most 255 characters long; a call given a
+ * bad one fails (returning -1, if it returns anything), rather than
+ * touching memory it shouldn't.
  */
  
 /* A unique identifier for an open Nachos file. */
@@ -125,6 +138,71 @@ SpaceId Fork(void (*func)());
  */
 void Yield();		
 
+/* Save the state of all the user programs into the host file "name", to
+ * be resumed later with "nachos -restore name".  Returns 0 after saving,
+ * 1 when running again from the checkpoint, and -1 on failure.
+ */
+int Checkpoint(char *name);
+
+/* Memory allocation: move the end of the heap, which starts just past the
+ * program's uninitialized data, by "increment" bytes (back, if negative).
+ * Returns the old end of the heap -- the start of the new memory -- or -1
+ * if there isn't room.  New memory starts out zeroed, and is only given a
+ * physical page when it is first touched.
+ */
+char *Sbrk(int increment);
+
+/* Shared memory: segments of memory that several processes can map at
+ * once, so that what one stores there the others see straight away.
+ */
+
+/* Create a shared segment called "name", of "size" bytes, all zeroes.
+ * It lasts until we exit (or Exec), or the last process attaching it
+ * detaches, whichever is later.  Returns 0, or -1 if there is a segment
+ * of that name already, or no memory for it.
+ */
+int ShmCreate(char *name, int size);
+
+/* Map the shared segment called "name" into our address space.  Returns
+ * where it starts, or -1 if there is no such segment or no room for it.
+ * Forked processes inherit the segments attached.
+ */
+char *ShmAttach(char *name);
+
+/* Unmap the shared segment attached at "addr".  The last process to
+ * let go of a segment (see ShmCreate) frees it.  Returns 0, or -1 if
+ * none is attached there.
+ */
+int ShmDetach(char *addr);
+
+/* Memory-mapped files: map the whole of the open file "id" into our
+ * address space, and return where it starts, or -1 if it can't be mapped
+ * (the console, an empty file, or no room).  Pages are read from the file
+ * as they are touched; what we store in them goes back to the file when
+ * it is unmapped (or the page is paged out), up to the length the file had
+ * when mapped.  The file stays mapped even if "id" is closed.  Forked
+ * processes don't inherit mapped files.
+ */
+char *Mmap(OpenFileId id);
+
+/* Write back and unmap the file mapped at "addr".  Returns 0, or -1 if
+ * none is mapped there.  Exit unmaps whatever is left mapped.
+ */
+int Munmap(char *addr);
+
+/* Create a pipe: a buffer in the kernel that what is written to one end
+ * can be read from at the other, in order, without going through the file
+ * system.  The id of the end read from is stored in ids[0], and of the
+ * end written to in ids[1].  Read waits until there is something to read,
+ * and returns 0 once every process has closed the end written to; Write
+ * waits for room, and fails once every process has closed the end read
+ * from.  Returns 0, or -1 if there are no file ids left.
+ *
+ * Processes inherit the files their parent has open (pipes included)
+ * when they are forked, and Exit closes them.
+ */
+int Pipe(OpenFileId *ids);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -0,0 +1,250 @@
+// textcache.cc
+//	Routines to share the code pages of an executable between all the
+//	address spaces running it.
+//
+//	Whoever maps a code page takes its own reference to the physical
+//	page from the memory manager; the cache holds one more, so the
+//	page stays put while any address space runs the executable, even
+//	when none of them maps it at the moment.  When memory runs short,
+//	the pager first has the cache give back such unmapped pages
+//	(Reclaim), and otherwise may take back a code page from all the
+//	address spaces mapping it, and from the cache (Forget); the next
+//	address space to touch it reads it in again.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "textcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SharedText::SharedText
+// 	Start an entry for the executable "image", with none of its code
+//	pages in memory.
+//----------------------------------------------------------------------
+
+SharedText::SharedText(NoffImage *image)
+{
+    name = new char[strlen(image->GetName()) + 1];
+    strcpy(name, image->GetName());
+    length = image->GetLength();
+    numPages = divRoundUp(image->noffH.code.virtualAddr +
+                          image->noffH.code.size, PageSize);
+    frames = new int[numPages];
+    for (unsigned int i = 0; i < numPages; i++)
+        frames[i] = -1;
+    users = 0;
+    next = NULL;
+}
+
+SharedText::~SharedText()
+{
+    delete [] name;
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// TextCache::TextCache
+// 	Start with no executables.
+//----------------------------------------------------------------------
+
+TextCache::TextCache()
+{
+    texts = NULL;
+    lock = new Semaphore("text cache lock", 1);
+}
+
+//----------------------------------------------------------------------
+// TextCache::~TextCache
+// 	Forget every executable; their pages go with physical memory.
+//----------------------------------------------------------------------
+
+TextCache::~TextCache()
+{
+    while (texts != NULL) {
+        SharedText *text = texts;
+
+        texts = text->next;
+        delete text;
+    }
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Attach
+// 	Return the entry for the executable "image", creating it if no
+//	address space runs the executable yet, and count one more user.
+//----------------------------------------------------------------------
+
+SharedText *
+TextCache::Attach(NoffImage *image)
+{
+    SharedText *text;
+    int length = image->GetLength();
+
+    lock->P();
+    for (text = texts; text != NULL; text = text->next)
+        if (text->length == length && !strcmp(text->name, image->GetName()))
+            break;
+    if (text == NULL) {
+        DEBUG('a', "Text cache: new entry for %s\n", image->GetName());
+        text = new SharedText(image);
+        text->next = texts;
+        texts = text;
+    }
+    text->users++;
+    lock->V();
+    return text;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Hold
+// 	Count one more user of "text": an address space forked from one
+//	running the executable.
+//----------------------------------------------------------------------
+
+void
+TextCache::Hold(SharedText *text)
+{
+    lock->P();
+    text->users++;
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// TextCache::Detach
+// 	Count one less user of "text".  When there are none left, give
+//	back the cache's references to the code pages, and forget the
+//	executable.
+//----------------------------------------------------------------------
+
+void
+TextCache::Detach(SharedText *text)
+{
+    lock->P();
+    ASSERT(text->users > 0);
+    if (--text->users > 0) {
+        lock->V();
+        return;
+    }
+
+    SharedText **prev = &texts;
+    while (*prev != NULL && *prev != text)
+        prev = &(*prev)->next;
+    if (*prev != NULL)          // not yet invalidated
+        *prev = text->next;
+    lock->V();
+
+    DEBUG('a', "Text cache: dropping %s\n", text->name);
+    for (unsigned int i = 0; i < text->numPages; i++)
+        if (text->frames[i] != -1)
+            mm->DeallocatePage(text->frames[i]);
+    delete text;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Lookup
+// 	Return the physical page holding code page "vpn" of "text", -1 if
+//	none does yet.  The caller adds its own reference to the page.
+//----------------------------------------------------------------------
+
+int
+TextCache::Lookup(SharedText *text, unsigned int vpn)
+{
+    if (vpn >= text->numPages)
+        return -1;
+    return text->frames[vpn];
+}
+
+//----------------------------------------------------------------------
+// TextCache::Insert
+// 	Record that physical page "frame", which the caller has just
+//	filled in and mapped, holds code page "vpn" of "text", and take a
+//	reference to it for the cache.  If someone else got there first,
+//	the caller simply keeps its page to itself.
+//----------------------------------------------------------------------
+
+void
+TextCache::Insert(SharedText *text, unsigned int vpn, int frame)
+{
+    lock->P();
+    if (vpn < text->numPages && text->frames[vpn] == -1) {
+        text->frames[vpn] = frame;
+        mm->SharePage(frame);
+    }
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// TextCache::Invalidate
+// 	The executable "name" has been written to: forget its code pages,
+//	so the next program to run it reads them in again.  Address spaces
+//	already running it keep sharing the old ones.
+//----------------------------------------------------------------------
+
+void
+TextCache::Invalidate(const char *name)
+{
+    lock->P();
+    for (SharedText **prev = &texts; *prev != NULL; prev = &(*prev)->next)
+        if (!strcmp((*prev)->name, name)) {
+            DEBUG('a', "Text cache: %s changed\n", name);
+            *prev = (*prev)->next;
+            break;
+        }
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// TextCache::Forget
+// 	The pager is taking back physical page "frame": if it is the one
+//	the cache has for code page "vpn" of "text", give back the cache's
+//	reference to it, so that the next address space to run the code
+//	reads the page in again.
+//----------------------------------------------------------------------
+
+void
+TextCache::Forget(SharedText *text, unsigned int vpn, int frame)
+{
+    lock->P();
+    if (vpn < text->numPages && text->frames[vpn] == frame) {
+        DEBUG('a', "Text cache: forgetting page %d of %s\n", vpn,
+              text->name);
+        text->frames[vpn] = -1;
+        mm->DeallocatePage(frame);
+    }
+    lock->V();
+}
+
+//----------------------------------------------------------------------
+// TextCache::Reclaim
+// 	Give back the first code page found that only the cache holds:
+//	the address spaces running the executable haven't touched it, or
+//	those that did have gone.  Pinned pages are left alone.
+//
+//	Returns FALSE if there is no such page.
+//----------------------------------------------------------------------
+
+bool
+TextCache::Reclaim()
+{
+    lock->P();
+    for (SharedText *text = texts; text != NULL; text = text->next)
+        for (unsigned int i = 0; i < text->numPages; i++) {
+            int frame = text->frames[i];
+
+            if (frame == -1 || mm->GetRefCount(frame) != 1 ||
+                mm->IsPinned(frame))
+                continue;
+            DEBUG('a', "Text cache: reclaiming page %d of %s\n", i,
+                  text->name);
+            text->frames[i] = -1;
+            mm->DeallocatePage(frame);
+            lock->V();
+            return TRUE;
+        }
+    lock->V();
+    return FALSE;
+}
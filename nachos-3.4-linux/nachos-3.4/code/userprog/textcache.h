@@ -0,0 +1,72 @@
+// textcache.h
+//	Data structures to share the code of a program between all the
+//	address spaces running it.
+//
+//	A page holding only code never changes, so every address space
+//	running the same executable can map the same physical page,
+//	read-only.  The text cache remembers, for each executable being
+//	run, which physical page holds each of its code pages, and keeps
+//	a reference to each of those pages for as long as some address
+//	space runs the executable, or until the pager needs the memory
+//	back.  So starting another copy of a program only costs memory
+//	for its data and stack.
+//
+//	Executables are told apart by name and length.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include "noffimage.h"
+#include "synch.h"
+
+// The code pages of one executable.
+
+class SharedText {
+  public:
+    SharedText(NoffImage *image);	// No code pages in memory yet
+    ~SharedText();
+
+    char *name;				// the executable's name
+    int length;				// and its length
+    unsigned int numPages;		// # of pages up to the end of code
+    int *frames;			// physical page holding each code
+					// page, -1 if none does
+    int users;				// # of address spaces running it
+    SharedText *next;			// the next executable in the cache
+};
+
+class TextCache {
+  public:
+    TextCache();
+    ~TextCache();
+
+    SharedText *Attach(NoffImage *image);
+					// Return the code pages of "image",
+					// for one more address space
+    void Hold(SharedText *text);	// One more address space runs it
+    void Detach(SharedText *text);	// One less; let go of its pages
+					// when there are none left
+    void Invalidate(const char *name);	// The executable "name" changed
+
+    int Lookup(SharedText *text, unsigned int vpn);
+					// The physical page holding code
+					// page "vpn", -1 if none does
+    void Insert(SharedText *text, unsigned int vpn, int frame);
+					// "frame" now holds code page "vpn"
+    void Forget(SharedText *text, unsigned int vpn, int frame);
+					// "frame" is being taken back; let
+					// go of it if it holds "vpn"
+    bool Reclaim();			// Let go of one code page nobody
+					// maps; FALSE if there is none
+
+  private:
+    SharedText *texts;			// every executable being run
+    Semaphore *lock;			// one change to the list at a time
+};
+
+#endif // TEXTCACHE_H
@@ -96,15 +96,12 @@ bool VNode::IsActive()
 //
 //  In linux, we have a VNode operation that uses the uio structure and
 //  the ureadc kernel service to read from file to a buffer. The uio structure
-//  describes a buffer that is not contiguous in main memory. The ureadc uses
-//  the uio structure and reads into the buffer byte by byte.
+//  describes a buffer that is not contiguous in main memory.
 //
 //  Similarly, here I have a virtual address for a buffer that's not
-//  contiguous in main memory. We shall use the Translate function from the
-//  address space instance to read from the file into our buffer byte by byte.
-//
-//  Our (virtAddr + AddrSpace::Translate) combination is analogous to the
-//  (uio + ureadc) combination in linux.
+//  contiguous in main memory. We split it only where it crosses into
+//  another page, and read each piece from the file in one go, straight
+//  into the page, which is pinned while we do (see AddrSpace::PinUser).
 //
 //  "virtAddr" is the virtual address of the buffer.
 //  "nBytes" is the number of bytes to read.
@@ -115,28 +112,36 @@ bool VNode::IsActive()
 int VNode::ReadAt(unsigned int virtAddr, unsigned int nBytes,
 					unsigned int offset)
 {
-	// TODO: Handle overflow of the buffer we are reading into
+	AddrSpace *space = currentThread->space;
 
-	// read file synchronously byte by byte
+	// read file synchronously, a page at a time
 	syncLock->P();
-	int totalBytes = 0;
-	for(unsigned int idx = 0; idx < nBytes; virtAddr++, idx++, offset++)
-    {
-        unsigned int physAddr = currentThread->space->Translate(virtAddr);
-		int bytesRead = fileObj->ReadAt(
-			&machine->mainMemory[physAddr], 1, offset);
-
-		if(bytesRead == 1) totalBytes++;
-
-		else if (bytesRead == 0) break;  // file end reached
+	unsigned int totalBytes = 0;
+	while(totalBytes < nBytes)
+	{
+		unsigned int addr = virtAddr + totalBytes;
+		int chunk = min(nBytes - totalBytes,
+			PageSize - addr % PageSize);  // to the page's end
+		char *into = space->PinUser(addr, TRUE);
+		if(into == NULL)
+		{
+			// the buffer isn't all in our memory
+			syncLock->V();
+			return -1;
+		}
+		int bytesRead =
+			fileObj->ReadAt(into, chunk, offset + totalBytes);
+		space->UnpinUser(into);
 
-		else
+		if(bytesRead < 0)
 		{
-			// byte read failed
+			// read failed
 			syncLock->V();
 			return -1;
 		}
-    }
+		totalBytes += bytesRead;
+		if(bytesRead < chunk) break;  // file end reached
+	}
 	syncLock->V();
 	return totalBytes;
 }
@@ -147,16 +152,12 @@ int VNode::ReadAt(unsigned int virtAddr, unsigned int nBytes,
 //
 //  In linux, we have a VNode operation that uses the uio structure and
 //  the uwritec kernel service to write from a buffer to the file. The uio
-//  structure describes a buffer that is not contiguous in main memory. The
-//  uwritec uses the uio structure and writes into the file byte by byte.
+//  structure describes a buffer that is not contiguous in main memory.
 //
 //  Similarly, here I have a virtual address for a buffer that's not
-//  contiguous in main memory. We shall use the Translate function from the
-//  address space instance to write into the file from our buffer byte by
-//  byte.
-//
-//  Our (virtAddr + AddrSpace::Translate) combination is analogous to the
-//  (uio + uwritec) combination in linux.
+//  contiguous in main memory. As for ReadAt, we write each piece of it
+//  in one page into the file in one go, straight from the pinned page.
+//  A '\0' ends the buffer early.
 //
 //  "virtAddr" is the buffer.
 //  "nBytes" is the number of bytes to write.
@@ -168,29 +169,92 @@ int VNode::WriteAt(unsigned int virtAddr, unsigned int nBytes,
 					unsigned int offset)
 {
 	// TODO: Handle what happens if disk has no sufficient space for write
+	AddrSpace *space = currentThread->space;
 
-	// write to file synchronously byte by byte
+	// the file may be a program: the next Exec must see the new contents
+	imageCache->Invalidate(name);
+
+	// write to file synchronously, a page at a time
 	syncLock->P();
-	int totalBytes = 0;
-	for(unsigned int idx = 0; idx < nBytes; virtAddr++, idx++, offset++)
+	unsigned int totalBytes = 0;
+	while(totalBytes < nBytes)
 	{
-		unsigned int physAddr = currentThread->space->Translate(virtAddr);
-        if(machine->mainMemory[physAddr] == '\0') break;  // end of buffer
-		int bytesWritten = fileObj->WriteAt(
-			&machine->mainMemory[physAddr], 1, offset);
+		unsigned int addr = virtAddr + totalBytes;
+		int chunk = min(nBytes - totalBytes,
+			PageSize - addr % PageSize);  // to the page's end
+		char *from = space->PinUser(addr, FALSE);
+		if(from == NULL)
+		{
+			// the buffer isn't all in our memory
+			syncLock->V();
+			return -1;
+		}
+		char *end = (char *) memchr(from, '\0', chunk);
+		if(end != NULL) chunk = end - from;  // end of buffer
 
-		if (bytesWritten == 1) totalBytes++;  // write successful
-		else
+		int bytesWritten = (chunk == 0) ? 0 :
+			fileObj->WriteAt(from, chunk, offset + totalBytes);
+		space->UnpinUser(from);
+
+		if(bytesWritten != chunk)
 		{
 			// write failed
 			syncLock->V();
 			return -1;
 		}
+		totalBytes += chunk;
+		if(end != NULL) break;
 	}
 	syncLock->V();
 	return totalBytes;
 }
 
+//------------------------------------------------------------------------
+// VNode::ReadInto()
+//  Read bytes from the file straight into a kernel buffer, for a page of
+//  a mapped file.
+//
+//  Unlike ReadAt, this doesn't take the vnode's lock: the pager calls it
+//  holding its own lock, which ReadAt may take (through PinUser) while
+//  holding ours.  One OpenFile::ReadAt is done in one go anyway.
+//
+//  "into" is the kernel buffer.
+//  "nBytes" is the number of bytes to read.
+//  "offset" is the file offset from where we will perform the read.
+//
+//  Return the number of bytes read.
+//------------------------------------------------------------------------
+int VNode::ReadInto(char *into, int nBytes, int offset)
+{
+	return fileObj->ReadAt(into, nBytes, offset);
+}
+
+//------------------------------------------------------------------------
+// VNode::WriteFrom()
+//  Write bytes from a kernel buffer straight into the file, for a page
+//  of a mapped file written back.  No lock, as for ReadInto.
+//
+//  "from" is the kernel buffer.
+//  "nBytes" is the number of bytes to write.
+//  "offset" is the file offset where we are going to write.
+//
+//  Return the number of bytes written.
+//------------------------------------------------------------------------
+int VNode::WriteFrom(char *from, int nBytes, int offset)
+{
+	imageCache->Invalidate(name);
+	return fileObj->WriteAt(from, nBytes, offset);
+}
+
+//------------------------------------------------------------------------
+// VNode::Length()
+//  Return the number of bytes in the file.
+//------------------------------------------------------------------------
+int VNode::Length()
+{
+	return fileObj->Length();
+}
+
 //------------------------------------------------------------------------
 // ConsoleVNode::ConsoleVNode
 //  Default Constructor.
@@ -203,7 +267,7 @@ ConsoleVNode::ConsoleVNode() : VNode()
 
 //------------------------------------------------------------------------
 // ConsoleVNode::ReadAt
-//  Read from console into a buffer.
+//  Read from console into a buffer, up to the end of the line.
 //
 //  "virtAddr" is the starting virtual address of the buffer.
 //  "nBytes" is the number of bytes to write.
@@ -214,29 +278,42 @@ ConsoleVNode::ConsoleVNode() : VNode()
 int ConsoleVNode::ReadAt(unsigned int virtAddr, unsigned int nBytes,
 							unsigned int offset)
 {
+	char buffer[PageSize];
+
 	syncLock->P();
-	int totalBytes = 0;
-	for(unsigned int idx = 0; idx < nBytes; virtAddr++, idx++, offset++)
-    {
-        unsigned int physAddr = currentThread->space->Translate(virtAddr);
-		int bytesRead = read(STDIN_FILENO, &machine->mainMemory[physAddr], 1);
-
-		if(bytesRead == 1) totalBytes++;
-		else
+	unsigned int totalBytes = 0;
+	bool endOfLine = false;
+	while(totalBytes < nBytes && !endOfLine)
+	{
+		// the console gives us a byte at a time
+		unsigned int chunk = min(nBytes - totalBytes, PageSize);
+		unsigned int bytesRead;
+		for(bytesRead = 0; bytesRead < chunk && !endOfLine; bytesRead++)
+		{
+			if(read(STDIN_FILENO, &buffer[bytesRead], 1) != 1)
+			{
+				// byte read failed
+				syncLock->V();
+				return -1;
+			}
+			endOfLine = (buffer[bytesRead] == '\n');
+		}
+		if(currentThread->space->CopyOut(buffer, virtAddr + totalBytes,
+				bytesRead) == -1)
 		{
-			// byte read failed
+			// the buffer isn't all in our memory
 			syncLock->V();
 			return -1;
 		}
-        if(machine->mainMemory[physAddr] == '\n') break;  // end of line
-    }
+		totalBytes += bytesRead;
+	}
 	syncLock->V();
 	return totalBytes;
 }
 
 //------------------------------------------------------------------------
 // ConsoleVNode::WriteAt
-//  Write to console from a buffer.
+//  Write to console from a buffer, up to a '\0'.
 //
 //  "virtAddr" is the starting virtual address of the buffer.
 //  "nBytes" is the number of bytes to write.
@@ -247,22 +324,32 @@ int ConsoleVNode::ReadAt(unsigned int virtAddr, unsigned int nBytes,
 int ConsoleVNode::WriteAt(unsigned int virtAddr, unsigned int nBytes,
 							unsigned int offset)
 {
+	char buffer[PageSize];
+
 	syncLock->P();
-	int totalBytes = 0;
-	for(unsigned int idx = 0; idx < nBytes; virtAddr++, idx++, offset++)
+	unsigned int totalBytes = 0;
+	while(totalBytes < nBytes)
 	{
-		unsigned int physAddr = currentThread->space->Translate(virtAddr);
-        if(machine->mainMemory[physAddr] == '\0') break;  // end of buffer
-		int bytesWritten = write(
-			STDOUT_FILENO, &machine->mainMemory[physAddr], 1);
+		unsigned int chunk = min(nBytes - totalBytes, PageSize);
+		if(currentThread->space->CopyIn(virtAddr + totalBytes, buffer,
+				chunk) == -1)
+		{
+			// the buffer isn't all in our memory
+			syncLock->V();
+			return -1;
+		}
+		char *end = (char *) memchr(buffer, '\0', chunk);
+		if(end != NULL) chunk = end - buffer;  // end of buffer
 
-		if (bytesWritten == 1) totalBytes++;  // write successful
-		else
+		if(chunk > 0 &&
+		   write(STDOUT_FILENO, buffer, chunk) != (int) chunk)
 		{
 			// write failed
 			syncLock->V();
 			return -1;
 		}
+		totalBytes += chunk;
+		if(end != NULL) break;
 	}
     //********************************************************************
     // Add a new life after every line because the test program expects it
@@ -272,3 +359,172 @@ int ConsoleVNode::WriteAt(unsigned int virtAddr, unsigned int nBytes,
 	syncLock->V();
 	return totalBytes;
 }
+
+//------------------------------------------------------------------------
+// PipeVNode::PipeVNode
+//  Constructor.
+//
+//  A pipe is not a file: the bytes written to it wait in a ring buffer in
+//  the kernel until they are read, and the vnode manager doesn't know
+//  about it.  Both ends start out open.
+//------------------------------------------------------------------------
+PipeVNode::PipeVNode() : VNode()
+{
+	name = (char *) "Pipe";
+	head = 0;
+	count = 0;
+	readerOpen = true;
+	writerOpen = true;
+	pipeLock = new Lock("pipe lock");
+	notEmpty = new Condition("pipe not empty");
+	notFull = new Condition("pipe not full");
+}
+
+//------------------------------------------------------------------------
+// PipeVNode::~PipeVNode
+//  Destructor.  Both ends must be closed.
+//------------------------------------------------------------------------
+PipeVNode::~PipeVNode()
+{
+	delete pipeLock;
+	delete notEmpty;
+	delete notFull;
+}
+
+//------------------------------------------------------------------------
+// PipeVNode::ReadAt
+//  Read from the pipe into a buffer.
+//
+//  Waits until there is something to read, then reads what there is, up
+//  to "nBytes" -- so a read may return fewer bytes than asked for.  Once
+//  the end written to is closed and everything written has been read,
+//  returns 0.  The bytes go straight from the ring buffer to the user's
+//  buffer, in at most two runs.
+//
+//  "virtAddr" is the starting virtual address of the buffer.
+//  "nBytes" is the number of bytes to read.
+//  "offset" (unused)
+//
+//  Returns the number of bytes read, or -1 if the buffer isn't all in
+//  our memory, or we are killed while we wait.
+//------------------------------------------------------------------------
+int PipeVNode::ReadAt(unsigned int virtAddr, unsigned int nBytes,
+						unsigned int offset)
+{
+	PCB *pcb = currentThread->space->pcb;
+
+	pipeLock->Acquire();
+	while(count == 0 && writerOpen && !pcb->IsKilled())
+		notEmpty->Wait(pipeLock);
+	if(pcb->IsKilled())
+	{
+		pipeLock->Release();
+		return -1;
+	}
+
+	int n = min((int) nBytes, count);
+	int first = min(n, PipeSize - head);  // up to the ring's end
+	AddrSpace *space = currentThread->space;
+	if(space->CopyOut(&buffer[head], virtAddr, first) == -1 ||
+	   space->CopyOut(buffer, virtAddr + first, n - first) == -1)
+	{
+		pipeLock->Release();
+		return -1;
+	}
+	head = (head + n) % PipeSize;
+	count -= n;
+	if(n > 0) notFull->Broadcast(pipeLock);  // there is room now
+
+	pipeLock->Release();
+	return n;
+}
+
+//------------------------------------------------------------------------
+// PipeVNode::WriteAt
+//  Write from a buffer into the pipe.
+//
+//  Waits for room whenever the pipe is full, until all "nBytes" are
+//  written, or the end read from is closed.  The bytes go straight from
+//  the user's buffer into the ring buffer, as much as there is room for
+//  at a time.
+//
+//  "virtAddr" is the starting virtual address of the buffer.
+//  "nBytes" is the number of bytes to write.
+//  "offset" (unused)
+//
+//  Returns the number of bytes written, or -1 if no one could ever read
+//  them, the buffer isn't all in our memory, or we are killed while we
+//  wait.
+//------------------------------------------------------------------------
+int PipeVNode::WriteAt(unsigned int virtAddr, unsigned int nBytes,
+						unsigned int offset)
+{
+	AddrSpace *space = currentThread->space;
+
+	pipeLock->Acquire();
+	unsigned int totalBytes = 0;
+	while(totalBytes < nBytes)
+	{
+		while(count == PipeSize && readerOpen &&
+		      !space->pcb->IsKilled())
+			notFull->Wait(pipeLock);
+		if(space->pcb->IsKilled())
+		{
+			pipeLock->Release();
+			return -1;
+		}
+		if(!readerOpen) break;
+
+		int n = min((int) (nBytes - totalBytes), PipeSize - count);
+		int tail = (head + count) % PipeSize;
+		int first = min(n, PipeSize - tail);  // up to the ring's end
+		if(space->CopyIn(virtAddr + totalBytes, &buffer[tail],
+				first) == -1 ||
+		   space->CopyIn(virtAddr + totalBytes + first, buffer,
+				n - first) == -1)
+		{
+			pipeLock->Release();
+			return -1;
+		}
+		count += n;
+		totalBytes += n;
+		notEmpty->Broadcast(pipeLock);  // something to read now
+	}
+
+	pipeLock->Release();
+	return (totalBytes == 0 && nBytes > 0) ? -1 : totalBytes;
+}
+
+//------------------------------------------------------------------------
+// PipeVNode::CloseEnd
+//  Close one end of the pipe, waking up everyone waiting on the other:
+//  readers then see the end of the data, and writers that no one reads.
+//
+//  "writeEnd" is whether it is the end written to that is closed.
+//
+//  Returns true if both ends are now closed, and the pipe can go.
+//------------------------------------------------------------------------
+bool PipeVNode::CloseEnd(bool writeEnd)
+{
+	pipeLock->Acquire();
+	if(writeEnd) writerOpen = false;
+	else readerOpen = false;
+	notEmpty->Broadcast(pipeLock);
+	notFull->Broadcast(pipeLock);
+	bool closed = !readerOpen && !writerOpen;
+	pipeLock->Release();
+	return closed;
+}
+
+//------------------------------------------------------------------------
+// PipeVNode::Wake
+//  Wake up everyone waiting on the pipe, so that a process killed while
+//  it waits sees it has been, and goes.  The others just wait again.
+//------------------------------------------------------------------------
+void PipeVNode::Wake()
+{
+	pipeLock->Acquire();
+	notEmpty->Broadcast(pipeLock);
+	notFull->Broadcast(pipeLock);
+	pipeLock->Release();
+}
@@ -9,6 +9,8 @@
 #include "openfile.h"
 #include "synch.h"
 
+#define PipeSize 512  // the number of bytes a pipe holds
+
 class VNode
 {
     public:
@@ -26,6 +28,11 @@ class VNode
         virtual int WriteAt(unsigned int virtAddr, unsigned int nBytes,
                     unsigned int offset);
 
+        // kernel buffers, for mapped files
+        int ReadInto(char *into, int nBytes, int offset);
+        int WriteFrom(char *from, int nBytes, int offset);
+        int Length();
+
     private:
         OpenFile *fileObj;
         int refCount;  // the number of open connections to the file
@@ -47,4 +54,28 @@ class ConsoleVNode: public VNode
                     unsigned int offset);
 };
 
+class PipeVNode: public VNode
+{
+    public:
+        PipeVNode();
+        virtual ~PipeVNode();
+
+        virtual int ReadAt(unsigned int virtAddr, unsigned int nBytes,
+                    unsigned int offset);
+        virtual int WriteAt(unsigned int virtAddr, unsigned int nBytes,
+                    unsigned int offset);
+        bool CloseEnd(bool writeEnd);
+        void Wake();
+
+    private:
+        char buffer[PipeSize];  // ring buffer of the bytes written and not
+        int head;  // yet read: "count" of them, from buffer[head] on
+        int count;
+        bool readerOpen;  // is the end read from still open?
+        bool writerOpen;  // and the end written to?
+        Lock *pipeLock;  // protects all of the above
+        Condition *notEmpty;  // readers wait here for bytes
+        Condition *notFull;  // writers wait here for room
+};
+
 #endif  // VNODE_H
@@ -57,7 +57,9 @@ VNode *VNodeManager::AssignVNode(const char *fileName)
                 void *item = tempList->Remove();
                 vnodes->Prepend(item);
             }
+            delete tempList;
 
+            vnmLock->V();
             return allocated_vnode;
         }
 
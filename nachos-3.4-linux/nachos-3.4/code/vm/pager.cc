@@ -0,0 +1,243 @@
+// pager.cc
+//	Routines to bring the pages of user programs into memory as they
+//	are touched, taking back physical pages when memory is full.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pager.h"
+#include "system.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// Pager::Pager
+// 	Initialize the pager, and create the swap file.
+//
+//	"replacement" is the policy for choosing the pages to take back
+//----------------------------------------------------------------------
+
+Pager::Pager(PageReplacement replacement)
+{
+    switch (replacement) {
+      case PageReplaceFIFO:
+	policy = new FIFOReplacement(machine->numPhysPages);
+	break;
+      case PageReplaceLRU:
+	policy = new LRUReplacement(machine->numPhysPages);
+	break;
+      default:
+	policy = new ClockReplacement(machine->numPhysPages);
+	break;
+    }
+    swap = new SwapSpace(SwapFileName, SwapPages);
+    lock = new Semaphore("pager lock", 1);
+}
+
+//----------------------------------------------------------------------
+// Pager::~Pager
+// 	Remove the swap file.
+//----------------------------------------------------------------------
+
+Pager::~Pager()
+{
+    delete policy;
+    delete swap;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Pager::PageIn
+// 	Handle a page fault on page "vpn" of "space", which isn't in
+//	memory: find a physical page for it, taking one back if memory is
+//	full, and fill it in -- from the swap file if the page was saved
+//	there, from its file if it is part of a mapped file, otherwise
+//	from the executable.  A page holding nothing from the executable
+//	(including heap and stack) just gets a page from the pool of
+//	zeroed pages.
+//
+//	A code page another address space running the program has
+//	brought in is simply shared; one we bring in is offered to the
+//	text cache, for the next address space to share.
+//
+//	Returns FALSE if every physical page is in use and none can be
+//	taken back.
+//----------------------------------------------------------------------
+
+bool
+Pager::PageIn(AddrSpace *space, unsigned int vpn)
+{
+    lock->P();
+    PageTableEntry *entry = space->GetPageTable()->Lookup(vpn);
+    if (entry != NULL && entry->valid) {	// someone beat us to it
+	lock->V();
+	return TRUE;
+    }
+
+    SharedText *text = space->GetText();
+    bool isText = (text != NULL && space->GetImage()->IsTextPage(vpn));
+    int frame = isText ? textCache->Lookup(text, vpn) : -1;
+    if (frame != -1) {
+	DEBUG('a', "Sharing code page %d for vpn %d\n", frame, vpn);
+	mm->SharePage(frame);
+	space->MapPage(vpn, frame);
+	stats->numPageFaults++;
+	lock->V();
+	return TRUE;
+    }
+
+    int slot = space->GetSwapSlot(vpn);
+    bool isFile = (slot == -1 && space->IsFilePage(vpn));
+    bool isZero = (slot == -1 && space->IsZeroPage(vpn));
+    ASSERT(slot != -1 || isFile || isZero || space->GetImage() != NULL);
+    frame = FindFrame(isZero);
+    if (frame == -1) {
+	DEBUG('a', "No page to bring in vpn %d\n", vpn);
+	lock->V();
+	return FALSE;
+    }
+    char *into = &machine->mainMemory[frame * PageSize];
+    if (slot != -1) {
+	DEBUG('a', "Paging in vpn %d from swap slot %d\n", vpn, slot);
+	swap->ReadPage(slot, into);
+    } else if (isFile)
+	space->ReadFilePage(vpn, into);
+    else if (!isZero)
+	space->GetImage()->ReadPage(vpn, into);
+    space->MapPage(vpn, frame);
+    if (isText)
+	textCache->Insert(text, vpn, frame);
+    stats->numPageFaults++;
+    lock->V();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::AllocateFrame
+// 	Return a free physical page, taking one back if memory is full;
+//	-1 if no page can be taken back.  If "zeroed", the page is all
+//	zeroes.
+//----------------------------------------------------------------------
+
+int
+Pager::AllocateFrame(bool zeroed)
+{
+    lock->P();
+    int frame = FindFrame(zeroed);
+    lock->V();
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// Pager::FindFrame
+// 	Return a free physical page, taking one back if memory is full;
+//	-1 if no page can be taken back.  If "zeroed", the page is all
+//	zeroes.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+int
+Pager::FindFrame(bool zeroed)
+{
+    if (mm->GetFreePageCount() == 0 && !Evict())
+	return -1;
+
+    int frame = mm->AllocatePage(zeroed);
+    policy->PageLoaded(frame);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// Pager::Evict
+// 	Take back a physical page: one holding code that the text cache
+//	keeps but no address space maps, if there is one, otherwise the
+//	page the replacement policy chooses.  That page is taken from
+//	every address space sharing it, and from the text cache.
+//
+//	Returns FALSE if no page can be taken back, or the swap file is
+//	full.
+//----------------------------------------------------------------------
+
+bool
+Pager::Evict()
+{
+    if (textCache->Reclaim())
+	return TRUE;
+
+    machine->SyncTLB();		// the page tables get the TLB's use bits
+    int frame = policy->FindVictim();
+    machine->FlushSoftTLB();	// the policy may have cleared use bits
+    if (frame == -1)
+	return FALSE;
+
+    // a code page first leaves the cache, so nobody picks it up again
+    FrameMapping *mapping = mm->GetMappings(frame);
+    SharedText *text = mapping->space->GetText();
+    if (text != NULL)
+	textCache->Forget(text, mapping->vpn, frame);
+    while ((mapping = mm->GetMappings(frame)) != NULL)
+	if (!PageOut(mapping->space, mapping->vpn, frame))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::PageOut
+// 	Take virtual page "vpn" of "owner" out of physical page "frame".
+//	If the page has been written to since it was brought in, save it
+//	in the swap file first, in the slot it had before if it had one --
+//	or, if it is part of a mapped file, write it back to the file.
+//
+//	Returns FALSE, leaving the page mapped, if the swap file is full.
+//----------------------------------------------------------------------
+
+bool
+Pager::PageOut(AddrSpace *owner, unsigned int vpn, int frame)
+{
+    PageTableEntry *entry = owner->GetPageTable()->Lookup(vpn);
+
+    DEBUG('a', "Evicting vpn %d from page %d%s\n", vpn, frame,
+	  entry->dirty ? ", dirty" : "");
+    if (entry->dirty && owner->IsFilePage(vpn)) {
+	owner->WriteFilePage(vpn, &machine->mainMemory[frame * PageSize]);
+	entry->dirty = FALSE;
+    } else if (entry->dirty) {
+	int slot = owner->GetSwapSlot(vpn);
+	if (slot == -1) {
+	    slot = swap->Allocate();
+	    if (slot == -1) {
+		DEBUG('a', "Swap file is full\n");
+		return FALSE;
+	    }
+	    owner->SetSwapSlot(vpn, slot);
+	}
+	swap->WritePage(slot, &machine->mainMemory[frame * PageSize]);
+	entry->dirty = FALSE;
+    }
+    owner->UnmapPage(vpn);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::CopySwap
+// 	Return a new slot of the swap file, holding a copy of "slot";
+//	used when a process is forked while some of its pages are only
+//	in the swap file.  Returns -1 if the swap file is full (and the
+//	fork fails).
+//----------------------------------------------------------------------
+
+int
+Pager::CopySwap(int slot)
+{
+    char buffer[PageSize];
+    int copy = swap->Allocate();
+
+    if (copy == -1)
+    {
+        DEBUG('a', "No swap slot to copy slot %d into\n", slot);
+        return -1;
+    }
+    swap->ReadPage(slot, buffer);
+    swap->WritePage(copy, buffer);
+    return copy;
+}
@@ -0,0 +1,70 @@
+// pager.h
+//	Data structures for demand paging of user programs.
+//
+//	An address space starts out with none of its pages in memory.
+//	The first time a page is touched, the machine raises a page fault,
+//	and the pager finds a physical page for it -- a free one, or one
+//	it takes back from another virtual page -- and fills it in, from
+//	the swap file if the page was saved there, otherwise from the
+//	executable.
+//
+//	Which page is taken back is up to the replacement policy (see
+//	replacement.h).  A page that has been written to is saved in the
+//	swap file first (or, for a page of a mapped file, written back to
+//	the file); a clean one is simply dropped, since it can be read in
+//	again from wherever it came from.  A shared page is taken back
+//	from every address space mapping it, and a code page from the
+//	text cache too; code pages the cache holds that nobody maps go
+//	before anything else.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "copyright.h"
+#include "replacement.h"
+#include "swap.h"
+#include "synch.h"
+
+#define SwapFileName	"SWAP"		// the swap file, in the Nachos
+					// file system
+#define SwapPages	1024		// # of pages it can hold
+
+class AddrSpace;
+
+class Pager {
+  public:
+    Pager(PageReplacement replacement);	// Start with all memory free,
+					// and an empty swap file
+    ~Pager();				// Remove the swap file
+
+    bool PageIn(AddrSpace *space, unsigned int vpn);
+					// Bring page "vpn" of "space" into
+					// memory; FALSE if there is no
+					// page we can use for it
+    int AllocateFrame(bool zeroed = FALSE);
+					// Return a free physical page,
+					// taking one back if need be; -1 if
+					// none can be
+
+    SwapSpace *GetSwap() { return swap; }
+    int CopySwap(int slot);		// Return a new slot holding a copy
+					// of "slot"; -1 if there is none
+
+  private:
+    int FindFrame(bool zeroed);		// AllocateFrame, with the lock held
+    bool Evict();			// Take back one physical page;
+					// FALSE if none can be
+    bool PageOut(AddrSpace *owner, unsigned int vpn, int frame);
+					// Save page "vpn" of "owner", in
+					// "frame", if need be, and unmap it
+
+    ReplacementPolicy *policy;		// chooses the pages to take back
+    SwapSpace *swap;			// where dirty pages are saved
+    Semaphore *lock;			// one page fault at a time
+};
+
+#endif // PAGER_H
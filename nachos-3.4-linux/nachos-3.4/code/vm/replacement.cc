@@ -0,0 +1,186 @@
+// replacement.cc
+//	Routines to choose the physical page to take back, by the FIFO,
+//	clock and approximate LRU policies.
+//
+//	The use bits of the page tables are only up to date after
+//	Machine::SyncTLB; the pager calls it before asking for a victim.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "replacement.h"
+#include "system.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Candidate
+// 	Return a page table entry mapping physical page "frame", if the
+//	page can be taken back: it isn't pinned, and every reference to it
+//	is a page table entry (or the text cache's), so every address
+//	space sharing it can read it in again.  A page of a shared memory
+//	segment, say, can't be.  Otherwise return NULL.
+//
+//	A shared page counts as used if any address space sharing it has
+//	used it, so their use bits are gathered into the entry returned.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+ReplacementPolicy::Candidate(int frame)
+{
+    FrameMapping *first = mm->GetMappings(frame);
+
+    if (first == NULL || mm->IsPinned(frame))
+	return NULL;
+
+    TranslationEntry *entry = first->space->GetPageTable()->Lookup(first->vpn);
+    int refs = 0;
+    for (FrameMapping *m = first; m != NULL; m = m->next) {
+	TranslationEntry *other = m->space->GetPageTable()->Lookup(m->vpn);
+
+	refs++;
+	if (other != entry && other->use) {
+	    entry->use = TRUE;
+	    other->use = FALSE;
+	}
+    }
+    SharedText *text = first->space->GetText();
+    if (text != NULL && textCache->Lookup(text, first->vpn) == frame)
+	refs++;
+    return (refs == mm->GetRefCount(frame)) ? entry : NULL;
+}
+
+//----------------------------------------------------------------------
+// FIFOReplacement::FIFOReplacement
+// 	Initialize FIFO replacement over "frames" physical pages.
+//----------------------------------------------------------------------
+
+FIFOReplacement::FIFOReplacement(int frames)
+{
+    numFrames = frames;
+    loadTime = new unsigned int[numFrames];
+    for (int i = 0; i < numFrames; i++)
+	loadTime[i] = 0;
+    now = 0;
+}
+
+FIFOReplacement::~FIFOReplacement()
+{
+    delete [] loadTime;
+}
+
+//----------------------------------------------------------------------
+// FIFOReplacement::PageLoaded
+// 	Note when "frame" was filled.
+//----------------------------------------------------------------------
+
+void
+FIFOReplacement::PageLoaded(int frame)
+{
+    loadTime[frame] = ++now;
+}
+
+//----------------------------------------------------------------------
+// FIFOReplacement::FindVictim
+// 	Return the page that can be taken back and was filled the longest
+//	time ago; -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+FIFOReplacement::FindVictim()
+{
+    int victim = -1;
+
+    for (int i = 0; i < numFrames; i++)
+	if (Candidate(i) != NULL &&
+	    (victim == -1 || loadTime[i] < loadTime[victim]))
+	    victim = i;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// ClockReplacement::ClockReplacement
+// 	Initialize clock replacement over "frames" physical pages.
+//----------------------------------------------------------------------
+
+ClockReplacement::ClockReplacement(int frames)
+{
+    numFrames = frames;
+    hand = 0;
+}
+
+//----------------------------------------------------------------------
+// ClockReplacement::FindVictim
+// 	Sweep the pages from where the last sweep stopped, taking the
+//	first one that can be taken back and hasn't been used since the
+//	hand last passed it; pages that have been used get a second
+//	chance, and lose their use bit.  Two turns of the hand are
+//	enough to find a victim, if there is one.
+//----------------------------------------------------------------------
+
+int
+ClockReplacement::FindVictim()
+{
+    for (int i = 0; i < 2 * numFrames; i++) {
+	int frame = hand;
+	TranslationEntry *entry = Candidate(frame);
+
+	hand = (hand + 1) % numFrames;
+	if (entry == NULL)
+	    continue;
+	if (entry->use) {
+	    entry->use = FALSE;
+	    continue;
+	}
+	return frame;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// LRUReplacement::LRUReplacement
+// 	Initialize approximate LRU replacement over "frames" physical
+//	pages.  The ages are kept in the core map.
+//----------------------------------------------------------------------
+
+LRUReplacement::LRUReplacement(int frames)
+{
+    numFrames = frames;
+}
+
+//----------------------------------------------------------------------
+// LRUReplacement::PageLoaded
+// 	A page just brought in counts as just used.
+//----------------------------------------------------------------------
+
+void
+LRUReplacement::PageLoaded(int frame)
+{
+    mm->SetAge(frame, 0x80);
+}
+
+//----------------------------------------------------------------------
+// LRUReplacement::FindVictim
+// 	Age every page by its use bit since the last victim was chosen,
+//	clearing the bit, and return the page that can be taken back with
+//	the lowest age; -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+LRUReplacement::FindVictim()
+{
+    int victim = -1;
+
+    for (int i = 0; i < numFrames; i++) {
+	TranslationEntry *entry = Candidate(i);
+
+	if (entry == NULL)
+	    continue;
+	mm->SetAge(i, (mm->GetAge(i) >> 1) | (entry->use ? 0x80 : 0));
+	entry->use = FALSE;
+	if (victim == -1 || mm->GetAge(i) < mm->GetAge(victim))
+	    victim = i;
+    }
+    return victim;
+}
@@ -0,0 +1,87 @@
+// replacement.h
+//	Data structures for choosing which physical page the pager takes
+//	back when memory is full.
+//
+//	A replacement policy is told about every page the pager fills,
+//	and asked for a victim when there is no free page.  Only a page
+//	that isn't pinned, and that is held only by the page table entries
+//	mapping it (and the text cache), can be a victim; those entries
+//	say whether it has been used or written to.
+//
+//	There are three policies:
+//
+//	  FIFO	    the page that was brought in longest ago
+//	  clock	    second chance: sweep the pages in order, passing over
+//		    (and clearing the use bit of) pages used since the
+//		    hand last came by
+//	  LRU	    approximately least recently used: every time a victim
+//		    is chosen, each page's use bit is shifted into an
+//		    8-bit age, kept in the core map, and the page with the
+//		    lowest age is taken
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include "copyright.h"
+#include "translate.h"
+
+// The policies the pager can use.
+enum PageReplacement { PageReplaceFIFO, PageReplaceClock, PageReplaceLRU };
+
+class ReplacementPolicy {
+  public:
+    virtual ~ReplacementPolicy() {}
+
+    virtual void PageLoaded(int frame) {}
+					// "frame" was just filled
+    virtual int FindVictim() = 0;	// Return the frame to take back;
+					// -1 if none can be
+
+  protected:
+    TranslationEntry *Candidate(int frame);
+					// A page table entry mapping
+					// "frame", NULL if it can't be
+					// taken back
+};
+
+class FIFOReplacement : public ReplacementPolicy {
+  public:
+    FIFOReplacement(int frames);
+    ~FIFOReplacement();
+
+    void PageLoaded(int frame);
+    int FindVictim();
+
+  private:
+    int numFrames;
+    unsigned int *loadTime;		// when each frame was filled
+    unsigned int now;			// # of frames filled so far
+};
+
+class ClockReplacement : public ReplacementPolicy {
+  public:
+    ClockReplacement(int frames);
+
+    int FindVictim();
+
+  private:
+    int numFrames;
+    int hand;				// where the sweep resumes
+};
+
+class LRUReplacement : public ReplacementPolicy {
+  public:
+    LRUReplacement(int frames);
+
+    void PageLoaded(int frame);
+    int FindVictim();
+
+  private:
+    int numFrames;
+};
+
+#endif // REPLACEMENT_H
@@ -0,0 +1,91 @@
+// swap.cc
+//	Routines to save user pages to, and read them back from, the
+//	swap file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swap.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Create the swap file, big enough for "numSlots" pages, and start
+//	with every slot free.
+//
+//	"fileName" is the name of the swap file in the Nachos file system
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(const char *fileName, int numSlots)
+{
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    ASSERT(fileSystem->Create(name, numSlots * PageSize));
+    file = fileSystem->Open(name);
+    ASSERT(file != NULL);
+    slots = new BitMap(numSlots);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Close the swap file, and remove it; its contents are of no use
+//	once Nachos stops.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    delete file;
+    fileSystem->Remove(name);
+    delete slots;
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate, SwapSpace::Free
+// 	Hand out and take back slots of the swap file.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    return slots->Find();
+}
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(slots->Test(slot));
+    slots->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage, SwapSpace::WritePage
+// 	Read or write one page of the swap file, timing the transfer.
+//
+//	"slot" is the page of the swap file
+//	"into", "from" are where the page goes in, or comes from, memory
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *into)
+{
+    double start = HostMicroseconds();
+
+    ASSERT(slots->Test(slot));
+    file->ReadAt(into, PageSize, slot * PageSize);
+    stats->numPageIns++;
+    stats->pageInTime += HostMicroseconds() - start;
+}
+
+void
+SwapSpace::WritePage(int slot, char *from)
+{
+    double start = HostMicroseconds();
+
+    ASSERT(slots->Test(slot));
+    file->WriteAt(from, PageSize, slot * PageSize);
+    stats->numPageOuts++;
+    stats->pageOutTime += HostMicroseconds() - start;
+}
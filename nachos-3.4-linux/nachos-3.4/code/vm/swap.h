@@ -0,0 +1,40 @@
+// swap.h
+//	Data structures for the backing store of user pages.
+//
+//	The swap space is a Nachos file divided into page-sized slots.
+//	When the pager takes back a page that has been written to, its
+//	contents are saved in a slot, and read back from it the next time
+//	the page is touched.  Pages that were never written to don't need
+//	a slot: they are read in again from the executable.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "filesys.h"
+#include "bitmap.h"
+
+class SwapSpace {
+  public:
+    SwapSpace(const char *fileName, int numSlots);
+					// Create the swap file, with room
+					// for "numSlots" pages
+    ~SwapSpace();			// Close and remove the swap file
+
+    int Allocate();			// Return a free slot, -1 if full
+    void Free(int slot);		// Give a slot back
+
+    void ReadPage(int slot, char *into);
+    void WritePage(int slot, char *from);
+
+  private:
+    char *name;				// the swap file's name
+    OpenFile *file;			// the swap file
+    BitMap *slots;			// which slots are in use
+};
+
+#endif // SWAP_H